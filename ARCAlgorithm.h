@@ -0,0 +1,218 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <mutex>
+#include "LRUAlgorithm.h"
+#include "AlgorithmStandard.h"
+
+namespace ARC
+{
+    /*
+    ARC（自适应替换缓存）
+    T1：只被访问过一次的数据（偏“最近”），T2：被访问过至少两次的数据（偏“频繁”）
+    B1/B2：分别是从T1/T2淘汰出去的key（幽灵表，只保留key不保留value）
+    p 是T1的目标大小：
+        在B1里再次遇到某个key，说明T1留得太少了，p增大；
+        在B2里再次遇到某个key，说明T2留得太少了，p减小
+    这样在扫描型负载（偏T1）和热点型负载（偏T2）之间自动调整
+    四条链表都放在同一个LRUNodePool里，链表头部是各自最久未访问的节点
+    */
+    template<typename Key,typename Value>
+    class ARCAlgorithm final : public AlgorithmStandard::Algorithmstandard<Key,Value>
+    {
+        static constexpr std::uint32_t T1=0;
+        static constexpr std::uint32_t T2=1;
+        static constexpr std::uint32_t B1=2;
+        static constexpr std::uint32_t B2=3;
+
+        std::unordered_map<Key,std::uint32_t> cache;
+        // 同时索引真实数据（T1/T2）和幽灵key（B1/B2），通过节点的list区分
+        LRU::LRUNodePool<Key,Value> pool;
+        std::size_t listSize[4];
+        std::size_t capacity;
+        std::size_t p;
+        AlgorithmStandard::TimedMutex<std::mutex> mutex{this->statistics};
+
+        void moveTo(const std::uint32_t list,const std::uint32_t index)
+        {
+            listSize[pool[index].list]--;
+            pool.moveNodeToLast(list,index);
+            listSize[list]++;
+        }
+
+        void deleteFirst(const std::uint32_t list)
+        {
+            const std::uint32_t index=pool.first(list);
+            cache.erase(pool[index].key);
+            pool.removeNode(index);
+            pool.release(index);
+            listSize[list]--;
+        }
+
+        // 真实数据中淘汰一个，变成对应幽灵表里的key
+        void replace(const bool inB2)
+        {
+            CACHE_LATENCY_SCOPE(EVICTION);
+            std::uint32_t index;
+            std::uint32_t ghost;
+            if (listSize[T1]>0 && (listSize[T2]==0 || (inB2 && listSize[T1]==p) || listSize[T1]>p))
+            {
+                index=pool.first(T1);
+                ghost=B1;
+            }
+            else
+            {
+                index=pool.first(T2);
+                ghost=B2;
+            }
+            pool[index].value=Value{};
+            // 幽灵节点不再需要value，及时释放它占用的内存
+            moveTo(ghost,index);
+            this->statistics.record(AlgorithmStandard::StatsEvent::EVICTION);
+        }
+
+        // 幽灵命中：调整p，腾出位置后把key重新放回T2
+        void ghostHit(const std::uint32_t index,const Value& val)
+        {
+            // value先写进去再调整p、腾位置：赋值抛出异常时它仍然是完整的幽灵，p和真实数据都没有变化
+            pool[index].value=val;
+            const bool inB2=pool[index].list==B2;
+            if (inB2)
+            {
+                const std::size_t delta=std::max<std::size_t>(listSize[B1]/listSize[B2],1);
+                p=p>delta?p-delta:0;
+            }
+            else
+            {
+                const std::size_t delta=std::max<std::size_t>(listSize[B2]/listSize[B1],1);
+                p=std::min(capacity,p+delta);
+            }
+            if (listSize[T1]+listSize[T2]>=capacity)
+            {
+                replace(inB2);
+            }
+            moveTo(T2,index);
+        }
+
+        // 调用前key已经在索引里占好位，iter指向这个占位，由调用者的guard在插入完成后release
+        void NewNodeInsert(const typename std::unordered_map<Key,std::uint32_t>::iterator iter,const Key& key,const Value& val)
+        {
+            // key、value先拷贝好再腾位置：拷贝抛出异常时还没有淘汰任何条目，listSize也和实际一致
+            Key NewKey=key;
+            Value NewValue=val;
+            if (listSize[T1]+listSize[B1]>=capacity)
+            {
+                if (listSize[T1]<capacity)
+                {
+                    deleteFirst(B1);
+                    if (listSize[T1]+listSize[T2]>=capacity)
+                    {
+                        replace(false);
+                    }
+                }
+                else
+                {
+                    CACHE_LATENCY_SCOPE(EVICTION);
+                    deleteFirst(T1);
+                    this->statistics.record(AlgorithmStandard::StatsEvent::EVICTION);
+                    // T1满了时直接删掉的是真实数据，其余deleteFirst删的都是幽灵key
+                }
+            }
+            else
+            {
+                const std::size_t total=listSize[T1]+listSize[T2]+listSize[B1]+listSize[B2];
+                if (total>=capacity)
+                {
+                    if (total>=2*capacity)
+                    {
+                        deleteFirst(B2);
+                    }
+                    if (listSize[T1]+listSize[T2]>=capacity)
+                    {
+                        replace(false);
+                    }
+                }
+            }
+            // deleteFirst删掉的都是别的key，unordered_map的erase不会让iter失效
+            const std::uint32_t NewIndex=pool.allocate(std::move(NewKey),std::move(NewValue));
+            pool.addNodeToLast(T1,NewIndex);
+            listSize[T1]++;
+            iter->second=NewIndex;
+        }
+
+    public:
+        using AlgorithmStandard::Algorithmstandard<Key,Value>::put;
+        // 右值put使用基类的默认实现（退回到拷贝版本），这里只是避免被下面的put隐藏
+
+        explicit ARCAlgorithm(const std::size_t capacity=DEFAULT_CACHE_CAPACITY):
+            pool(2*capacity+1,4),listSize{0,0,0,0},capacity(capacity),p(0)
+        {
+            cache.reserve(2*capacity+1);
+            // 幽灵表最多再记住capacity个key，再加上新key插入时先占的一个位置
+        }
+        ~ARCAlgorithm() override=default;
+
+        bool get(const Key& key, Value& value) override
+        {
+            CACHE_LATENCY_SCOPE(GET);
+            std::lock_guard lock(mutex);
+            auto iter=cache.find(key);
+            if (iter==cache.end())
+            {
+                return this->recordLookup(false);
+            }
+            const std::uint32_t index=iter->second;
+            const std::uint32_t list=pool[index].list;
+            if (list==B1 || list==B2)
+            {
+                // 幽灵表里只有key，对get来说仍是未命中，等put带着value回来时再调整p
+                return this->recordLookup(false);
+            }
+            value=pool[index].value;
+            moveTo(T2,index);
+            return this->recordLookup(true);
+        }
+
+        void put(const Value& val,const Key& key) override
+        {
+            CACHE_LATENCY_SCOPE(PUT);
+            std::lock_guard lock(mutex);
+            if (capacity==0)
+            {
+                return;
+            }
+            auto [iter,inserted]=cache.try_emplace(key,0);
+            if (!inserted)
+            {
+                const std::uint32_t index=iter->second;
+                const std::uint32_t list=pool[index].list;
+                if (list==B1 || list==B2)
+                {
+                    this->recordPut(false);
+                    ghostHit(index,val);
+                }
+                else
+                {
+                    this->recordPut(true);
+                    pool[index].value=val;
+                    moveTo(T2,index);
+                }
+                return;
+            }
+            this->recordPut(false);
+            // 先在索引里占位，插入途中抛出异常时由guard撤销
+            AlgorithmStandard::PlaceholderGuard placeholder(cache,iter);
+            NewNodeInsert(iter,key,val);
+            placeholder.release();
+        }
+
+        std::size_t getCapacity()
+        {
+            std::lock_guard lock(mutex);
+            return capacity;
+        }
+    };
+}
@@ -1,4 +1,16 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+#include "SingleFlight.h"
+#include "AsyncLoad.h"
+#include "CacheStats.h"
+#include "LatencyHistogram.h"
 inline constexpr int DEFAULT_CACHE_CAPACITY=20;
 inline constexpr int OPERATIONS=500000;
 inline constexpr int HOTKEY=20;
@@ -12,6 +24,146 @@ namespace AlgorithmStandard
 
     // 使用const保护的指针传递要好过值传递
 
+    template<typename Value>
+    using ValueHandle=std::shared_ptr<const Value>;
+    // 指向缓存中value的只读句柄：命中时只增加一次引用计数，不拷贝value
+    // 句柄持有value的所有权，即使对应的key之后被淘汰或被put覆盖，已拿到的句柄依然有效（看到的是拿到时的那个版本）
+
+    /*
+    权重函数：返回一个条目占用的“容量”（例如value的字节数）
+    设置了权重函数的算法，容量的含义从“条目个数”变成“权重总和”的上限；不设置时每个条目权重为1，和按个数计算完全一样
+    */
+    template<typename Key,typename Value>
+    using Weigher=std::function<std::size_t(const Key&,const Value&)>;
+
+    // 节点里用32位保存权重，超出的部分按上限计算
+    template<typename Key,typename Value>
+    std::uint32_t weigh(const Weigher<Key,Value>& weigher,const Key& key,const Value& value)
+    {
+        if (!weigher)
+        {
+            return 1;
+        }
+        return static_cast<std::uint32_t>(std::min<std::size_t>(weigher(key,value),UINT32_MAX));
+    }
+
+    /*
+    覆盖节点中保存的value：
+    use_count()==1说明没有外部句柄，直接原地赋值，复用原有内存；
+    否则换一个新对象，已经交出去的句柄继续指向旧值
+    句柄只会在缓存的锁内从节点拷贝出去，所以锁内看到的use_count()==1是可靠的
+    */
+    template<typename Value,typename V>
+    void assignValue(std::shared_ptr<Value>& stored,V&& val)
+    {
+        if (stored!=nullptr && stored.use_count()==1)
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // 与其他线程释放最后一个句柄时的引用计数递减配对，保证它们对旧值的读取都已完成
+            *stored=std::forward<V>(val);
+        }
+        else
+        {
+            stored=std::make_shared<Value>(std::forward<V>(val));
+        }
+    }
+
+    /*
+    节点里value的保存方式，由算法的模板参数SharedValues选择
+    false：节点里直接保存Value，插入和命中都不经过堆，getHandle要拷贝一份value到新句柄里
+    true：节点里保存shared_ptr<Value>，getHandle只增加一次引用计数，不拷贝；
+          代价是每次插入新key都要make_shared一次，每次读取多一次指针跳转
+    */
+    template<typename Value,bool SharedValues>
+    struct ValueStorage
+    {
+        using Stored=Value;
+
+        template<typename... Args>
+        static Stored make(Args&&... args)
+        {
+            return Value(std::forward<Args>(args)...);
+        }
+        static const Value& get(const Stored& stored)
+        {
+            return stored;
+        }
+        template<typename V>
+        static void assign(Stored& stored,V&& val)
+        {
+            stored=std::forward<V>(val);
+        }
+        static ValueHandle<Value> handle(const Stored& stored)
+        {
+            return std::make_shared<const Value>(stored);
+        }
+    };
+
+    template<typename Value>
+    struct ValueStorage<Value,true>
+    {
+        using Stored=std::shared_ptr<Value>;
+
+        template<typename... Args>
+        static Stored make(Args&&... args)
+        {
+            return std::make_shared<Value>(std::forward<Args>(args)...);
+        }
+        static const Value& get(const Stored& stored)
+        {
+            return *stored;
+        }
+        template<typename V>
+        static void assign(Stored& stored,V&& val)
+        {
+            assignValue(stored,std::forward<V>(val));
+        }
+        static ValueHandle<Value> handle(const Stored& stored)
+        {
+            return stored;
+        }
+    };
+
+    /*
+    插入新key时先用try_emplace在索引里占位（一次查找同时判断key是否存在），再构造value、淘汰、挂链表
+    这期间value的构造函数、权重函数或内存分配都可能抛出异常，占位如果留在索引里，之后的查找会拿到一个不存在的节点
+    guard析构时撤销占位，插入真正完成后调用release()；插入被放弃（例如权重超过容量）时不调用release，同样由它撤销
+    */
+    template<typename Index>
+    class PlaceholderGuard
+    {
+        Index& index;
+        typename Index::iterator iter;
+        bool active;
+
+    public:
+        PlaceholderGuard(Index& index,const typename Index::iterator iter):index(index),iter(iter),active(true){}
+        ~PlaceholderGuard()
+        {
+            if (active)
+            {
+                index.erase(iter);
+            }
+        }
+        PlaceholderGuard(const PlaceholderGuard&)=delete;
+        PlaceholderGuard& operator=(const PlaceholderGuard&)=delete;
+
+        void release()
+        {
+            active=false;
+        }
+    };
+
+    // 提示CPU提前把一块内存读进缓存，批量操作时先把所有要访问的节点预取，再逐个处理
+    inline void prefetch(const void* address)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(address);
+#else
+        (void)address;
+#endif
+    }
+
     template<typename Key,typename Value>
     // 这是一个类模板声明
     class Algorithmstandard
@@ -22,10 +174,176 @@ namespace AlgorithmStandard
         virtual bool get(const Key& key, Value& value) = 0;
         // 使用bool确认是否查找成功，通过修改指针value传达key对应的value
         virtual void put(const Value& val,const Key& key)=0;
+        // 右值版本：value可以直接移动进缓存
+        // 默认实现退回到拷贝版本，LRU、LFU会重写为真正的移动
+        virtual void put(Value&& val,const Key& key)
+        {
+            put(static_cast<const Value&>(val),key);
+        }
+
+        /*
+        批量读写：一批key只加一次锁
+        getMany把keys[i]的结果写到values[i]，返回的位图中第i位表示keys[i]是否命中
+        putMany把values[i]写到keys[i]，参数顺序和put一样是先value后key
+        两个span长度不同时只处理较短的部分
+        默认实现只是逐个调用get/put，LRU、LFU、ShardedLRU会重写为一次加锁的版本
+        */
+        virtual std::vector<bool> getMany(std::span<const Key> keys,std::span<Value> values)
+        {
+            const std::size_t count=std::min(keys.size(),values.size());
+            std::vector<bool> hits(count);
+            for (std::size_t i=0;i<count;i++)
+            {
+                hits[i]=get(keys[i],values[i]);
+            }
+            return hits;
+        }
+        virtual void putMany(std::span<const Value> values,std::span<const Key> keys)
+        {
+            const std::size_t count=std::min(keys.size(),values.size());
+            for (std::size_t i=0;i<count;i++)
+            {
+                put(values[i],keys[i]);
+            }
+        }
+
+        // 未命中时返回空句柄
+        // 默认实现仍然要拷贝一次value，内部直接保存句柄的算法（LRU、LFU）会重写为零拷贝版本
+        virtual ValueHandle<Value> getHandle(const Key& key)
+        {
+            Value value;
+            if (get(key,value))
+            {
+                return std::make_shared<const Value>(std::move(value));
+            }
+            return nullptr;
+        }
+
+        /*
+        读取key，未命中时调用loader(key)加载并写回缓存，返回得到的value
+        同一个key并发未命中时只有一个线程执行loader，其他线程等待它的结果（single-flight）
+        loader在缓存的锁外执行；抢到加载权后会先再查一次缓存，避免刚被别人加载完又重复加载
+        这次再查不计入命中/未命中，一次加载的未命中在统计里只算一次
+        loader抛出的异常会传给所有正在等待这个key的调用者，不会写入缓存
+        */
+        template<typename Loader>
+        Value getOrLoad(const Key& key,Loader&& loader)
+        {
+            Value value;
+            if (get(key,value))
+            {
+                return value;
+            }
+            return loadFlights().sync.run(key,[&]
+            {
+                Value loaded;
+                bool cached;
+                {
+                    UncountedLookups uncounted;
+                    cached=get(key,loaded);
+                }
+                if (cached)
+                {
+                    return loaded;
+                }
+                loaded=loader(key);
+                put(loaded,key);
+                return loaded;
+            });
+        }
+
+        /*
+        协程版本：Value v=co_await cache.getAsync(key,loader);
+        loader的形式是 loader(key,done)，发起异步加载后立即返回，加载完成时调用 done(value)
+        同一个key并发未命中时只有第一个协程调用loader，其他协程挂起等待，加载完成后一起恢复
+        */
+        template<typename Loader>
+        auto getAsync(const Key& key,Loader&& loader)
+        {
+            return GetAwaiter<Algorithmstandard,Key,Value,std::decay_t<Loader>>(*this,loadFlights().async,key,std::forward<Loader>(loader));
+        }
+
+        /*
+        命中、未命中、写入、淘汰、过期、老化次数以及等锁时间的快照
+        各算法在自己的get/put/淘汰路径上计数，计数器按线程分条，读取时合并
+        由多个子缓存组成的算法（ShardedLRU）重写为把各部分的快照加起来
+        */
+        virtual CacheStats stats() const
+        {
+            return statistics.snapshot();
+        }
+
+        /*
+        get、put、淘汰、老化各自的延迟分布，见LatencyHistogram.h
+        只有定义了CACHE_LATENCY_HISTOGRAM时才会记录，否则返回的直方图都是空的
+        */
+        virtual LatencyReport latencies() const
+        {
+            return latencyRecorder.report();
+        }
+
+    protected:
+        StatsCounter statistics;
+        // 淘汰、过期等事件由派生类直接 this->statistics.record(...) 计数；互斥量用TimedMutex包装后等锁时间也记在这里
+        [[no_unique_address]] LatencyRecorder latencyRecorder;
+        // 派生类用CACHE_LATENCY_SCOPE(GET)等宏计时，不直接访问
+
+        // 记录一次查找，原样返回hit，可以直接写 return this->recordLookup(true);
+        bool recordLookup(const bool hit)
+        {
+            statistics.record(hit?StatsEvent::HIT:StatsEvent::MISS);
+            return hit;
+        }
+        // 批量查找的结果一次计入，每批只有两次原子加
+        void recordLookups(const std::uint64_t HitCount,const std::uint64_t LookupCount)
+        {
+            statistics.record(StatsEvent::HIT,HitCount);
+            statistics.record(StatsEvent::MISS,LookupCount-HitCount);
+        }
+        void recordLookups(const std::vector<bool>& hits)
+        {
+            recordLookups(static_cast<std::uint64_t>(std::count(hits.begin(),hits.end(),true)),hits.size());
+        }
+        // updated表示覆盖了已有的key
+        void recordPut(const bool updated)
+        {
+            statistics.record(StatsEvent::PUT);
+            if (updated) statistics.record(StatsEvent::UPDATE);
+        }
+
+    private:
+        struct Flights
+        {
+            SingleFlight<Key,Value> sync; // getOrLoad正在加载中的key
+            AsyncFlights<Key,Value> async; // getAsync正在加载中的key
+        };
+        /*
+        两张加载表有几KB，只有用到getOrLoad/getAsync的缓存才需要，第一次用到时再分配
+        多个线程同时第一次调用时用CAS决定留下哪一份，其余的直接释放；装好之后地址不再变化
+        */
+        std::atomic<Flights*> flights{nullptr};
+
+        Flights& loadFlights()
+        {
+            Flights* current=flights.load(std::memory_order_acquire);
+            if (current!=nullptr)
+            {
+                return *current;
+            }
+            auto created=std::make_unique<Flights>();
+            if (flights.compare_exchange_strong(current,created.get(),std::memory_order_acq_rel,std::memory_order_acquire))
+            {
+                return *created.release();
+            }
+            return *current;
+        }
     };
 
     template<typename Key, typename Value> // 这是一个模板
-    Algorithmstandard<Key, Value>::~Algorithmstandard() {}
+    Algorithmstandard<Key, Value>::~Algorithmstandard()
+    {
+        delete flights.load(std::memory_order_relaxed);
+    }
     // 因为基类的析构函数是一个虚函数，纯虚函数无法被直接使用（子类析构函数执行完后会调用父类析构函数）
     // 所以需要写出定义，使连接器可以找到析构函数的地址。
 }
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <array>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "CacheStats.h"
+#include "SingleFlight.h"
+
+namespace AlgorithmStandard
+{
+    /*
+    协程版本的合并加载（getAsync用）
+    每个正在加载的key对应一个Flight，等待它的协程把句柄挂在Flight上，加载完成时由完成加载的线程逐个恢复
+    同一时刻每个key只有第一个未命中的协程（leader）调用异步loader，后来的协程只是挂起等待，不占用线程
+    和SingleFlight一样按key分到FLIGHT_STRIPES张表里，各自加锁
+    */
+    template<typename Key,typename Value>
+    class AsyncFlights
+    {
+    public:
+        struct Flight
+        {
+            std::mutex mutex;
+            bool claimed=false; // 已经有一次完成抢到了完成权，之后的完成（重复调用、迟到的done、丢弃done）都忽略
+            bool done=false;
+            Value value{};
+            std::exception_ptr error;
+            std::vector<std::coroutine_handle<>> waiters;
+        };
+
+    private:
+        struct alignas(64) Stripe
+        {
+            std::mutex mutex;
+            std::unordered_map<Key,std::shared_ptr<Flight>> flights;
+        };
+
+        std::array<Stripe,FLIGHT_STRIPES> stripes;
+
+        // 同一个Flight只有第一次调用返回true
+        static bool claim(Flight& flight)
+        {
+            std::lock_guard lock(flight.mutex);
+            if (flight.claimed)
+            {
+                return false;
+            }
+            flight.claimed=true;
+            return true;
+        }
+
+        /*
+        调用者必须已经抢到完成权
+        先从表里摘掉，之后到来的协程会重新查缓存；再在Flight的锁外恢复所有等待者
+        */
+        void finish(const Key& key,const std::shared_ptr<Flight>& flight,Value* value,std::exception_ptr error)
+        {
+            {
+                Stripe& stripe=stripes[flightStripe(key)];
+                std::lock_guard lock(stripe.mutex);
+                auto iter=stripe.flights.find(key);
+                if (iter!=stripe.flights.end() && iter->second==flight)
+                {
+                    stripe.flights.erase(iter);
+                }
+            }
+            std::vector<std::coroutine_handle<>> waiters;
+            {
+                std::lock_guard lock(flight->mutex);
+                flight->done=true;
+                if (value!=nullptr) flight->value=std::move(*value);
+                flight->error=std::move(error);
+                waiters.swap(flight->waiters);
+            }
+            for (auto handle : waiters)
+            {
+                handle.resume();
+            }
+        }
+
+    public:
+        // 返回key对应的Flight，第二个值表示调用者是否是新登记的leader
+        std::pair<std::shared_ptr<Flight>,bool> join(const Key& key)
+        {
+            Stripe& stripe=stripes[flightStripe(key)];
+            std::lock_guard lock(stripe.mutex);
+            auto [iter,inserted]=stripe.flights.try_emplace(key,nullptr);
+            if (inserted)
+            {
+                iter->second=std::make_shared<Flight>();
+            }
+            return {iter->second,inserted};
+        }
+
+        /*
+        只有第一次完成（成功或失败）有效，之后的调用什么也不做
+        抢到完成权后先调用store(value)（写回缓存），再恢复等待者：已经失败、已经完成的Flight不会再写缓存，迟到的结果不会覆盖之后的put
+        store抛出的异常作为加载失败交给等待者
+        */
+        template<typename Store>
+        void complete(const Key& key,const std::shared_ptr<Flight>& flight,Value value,Store&& store)
+        {
+            if (!claim(*flight))
+            {
+                return;
+            }
+            try
+            {
+                store(std::as_const(value));
+            }
+            catch (...)
+            {
+                finish(key,flight,nullptr,std::current_exception());
+                return;
+            }
+            finish(key,flight,&value,nullptr);
+        }
+        // 不需要写回缓存的完成（值本来就是从缓存里读到的）
+        void complete(const Key& key,const std::shared_ptr<Flight>& flight,Value value)
+        {
+            complete(key,flight,std::move(value),[](const Value&){});
+        }
+
+        void fail(const Key& key,const std::shared_ptr<Flight>& flight,std::exception_ptr error)
+        {
+            if (claim(*flight))
+            {
+                finish(key,flight,nullptr,std::move(error));
+            }
+        }
+
+        // 已经完成就不挂起（返回false），否则把句柄挂到Flight上等待恢复
+        static bool wait(Flight& flight,const std::coroutine_handle<> handle)
+        {
+            std::lock_guard lock(flight.mutex);
+            if (flight.done)
+            {
+                return false;
+            }
+            flight.waiters.push_back(handle);
+            return true;
+        }
+    };
+
+    /*
+    co_await cache.getAsync(key,loader) 的等待体
+    命中时不挂起；未命中时leader调用 loader(key,done)，异步加载完成后由加载方调用 done(value)，
+    done会把value写回缓存并恢复所有等待这个key的协程（在调用done的线程上恢复）；只有第一次完成会写缓存，迟到的done什么也不做
+    加载失败时调用 done.fail(exception_ptr)；loader同步抛出的异常同样会传给所有等待者，
+    在co_await处重新抛出，不会写入缓存
+    done和等待中的协程都只保存缓存的地址：缓存必须比所有done的拷贝、所有挂起的协程活得更久
+    */
+    template<typename Cache,typename Key,typename Value,typename Loader>
+    class GetAwaiter
+    {
+        using Flight=typename AsyncFlights<Key,Value>::Flight;
+
+        Cache& cache;
+        AsyncFlights<Key,Value>& flights;
+        Key key;
+        Loader loader;
+        Value value;
+        std::shared_ptr<Flight> flight;
+
+    public:
+        /*
+        交给loader的完成回调，可以拷贝、可以在任意线程调用，只有第一次完成（成功或失败）有效
+        所有拷贝共享同一个State：最后一份拷贝销毁时如果还没有完成过，等待者会收到异常，不会永远挂起
+        */
+        class Completion
+        {
+            struct State
+            {
+                Cache* cache;
+                AsyncFlights<Key,Value>* flights;
+                Key key;
+                std::shared_ptr<Flight> flight;
+
+                State(Cache* cache,AsyncFlights<Key,Value>* flights,Key key,std::shared_ptr<Flight> flight):
+                    cache(cache),flights(flights),key(std::move(key)),flight(std::move(flight)){}
+                ~State()
+                {
+                    // 已经完成过时fail直接忽略
+                    flights->fail(key,flight,std::make_exception_ptr(std::runtime_error("getAsync: loader dropped the completion without calling it")));
+                }
+                State(const State&)=delete;
+                State& operator=(const State&)=delete;
+            };
+
+            std::shared_ptr<State> state;
+
+        public:
+            Completion(Cache* cache,AsyncFlights<Key,Value>* flights,Key key,std::shared_ptr<Flight> flight):
+                state(std::make_shared<State>(cache,flights,std::move(key),std::move(flight))){}
+
+            // 只有这次调用真正完成了Flight才写回缓存；Flight已经失败或者已经完成时，迟到的value直接丢弃
+            void operator()(Value loaded) const
+            {
+                State& current=*state;
+                current.flights->complete(current.key,current.flight,std::move(loaded),[&current](const Value& value)
+                {
+                    current.cache->put(value,current.key);
+                });
+            }
+
+            // 加载失败：等待者在co_await处收到这个异常，不写入缓存
+            void fail(std::exception_ptr error) const
+            {
+                state->flights->fail(state->key,state->flight,std::move(error));
+            }
+        };
+
+        GetAwaiter(Cache& cache,AsyncFlights<Key,Value>& flights,Key key,Loader loader):
+            cache(cache),flights(flights),key(std::move(key)),loader(std::move(loader)){}
+
+        bool await_ready()
+        {
+            return cache.get(key,value);
+        }
+
+        bool await_suspend(const std::coroutine_handle<> handle)
+        {
+            auto [joined,leader]=flights.join(key);
+            flight=std::move(joined);
+            if (leader)
+            {
+                // 抢到加载权后再查一次缓存，避免刚被别人加载完又重复加载；await_ready已经计过一次未命中，这次不计
+                Value cached;
+                bool cachedHit;
+                {
+                    UncountedLookups uncounted;
+                    cachedHit=cache.get(key,cached);
+                }
+                if (cachedHit)
+                {
+                    flights.complete(key,flight,std::move(cached));
+                }
+                else
+                {
+                    // 先留一份done，loader同步抛出时它还活着，等待者收到的是loader的异常而不是“done被丢弃”
+                    const Completion done(&cache,&flights,key,flight);
+                    try
+                    {
+                        loader(key,done);
+                    }
+                    catch (...)
+                    {
+                        done.fail(std::current_exception());
+                    }
+                }
+            }
+            // loader同步完成时这里直接返回false，协程不挂起
+            return AsyncFlights<Key,Value>::wait(*flight,handle);
+        }
+
+        Value await_resume()
+        {
+            if (flight==nullptr)
+            {
+                return std::move(value);
+            }
+            if (flight->error)
+            {
+                std::rethrow_exception(flight->error);
+            }
+            return flight->value;
+        }
+    };
+}
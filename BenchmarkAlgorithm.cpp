@@ -0,0 +1,247 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+#include <thread>
+#include <latch>
+#include <memory>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <optional>
+#include "AlgorithmStandard.h"
+#include "CacheEngines.h"
+
+/*
+多线程吞吐测试
+每个算法单独测试，每种线程数都重新创建一个实例并预热
+key和value在计时前全部生成好，计时区间内只有get/put本身
+用法: CacheBenchmark [--threads 1,2,4,8] [--ops 每线程操作数] [--capacity 容量]
+*/
+namespace BENCHMARK
+{
+    using Cache=AlgorithmStandard::Algorithmstandard<int,std::string>;
+    using Engine=ENGINES::Engine<int,std::string>;
+
+    struct BenchmarkConfig
+    {
+        std::vector<int> threadCounts{1,2,4,8};
+        int opsPerThread=OPERATIONS/5;
+        std::size_t capacity=1000;
+    };
+
+    // 一个线程提前生成好的操作序列
+    struct Operation
+    {
+        int key;
+        bool isGet;
+    };
+
+    struct ThreadResult
+    {
+        std::vector<long long> latencies;
+        long long gets=0;
+        long long hits=0;
+    };
+
+    // 和TestAlgorithm相同的访问模式：30%写70%读，70%访问热点数据；热点数据量等于容量，冷数据是容量的50倍
+    std::vector<Operation> makeOperations(const BenchmarkConfig& config,const unsigned seed)
+    {
+        const int HotKeys=static_cast<int>(config.capacity);
+        const int ColdKeys=HotKeys*50;
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution GetOrPut(1,10);
+        std::uniform_int_distribution HotOrCold(1,10);
+        std::uniform_int_distribution HotKeyGen(0,HotKeys-1);
+        std::uniform_int_distribution ColdKeyGen(HotKeys,HotKeys+ColdKeys-1);
+        std::vector<Operation> operations(config.opsPerThread);
+        for (auto& op : operations)
+        {
+            op.isGet=GetOrPut(rng)>3;
+            op.key=HotOrCold(rng)<=3?ColdKeyGen(rng):HotKeyGen(rng);
+        }
+        return operations;
+    }
+
+    long long percentile(const std::vector<long long>& sorted,const double p)
+    {
+        if (sorted.empty()) return 0;
+        return sorted[static_cast<std::size_t>(p*static_cast<double>(sorted.size()-1))];
+    }
+
+    void runOne(const Engine& engine,const int threads,const BenchmarkConfig& config,const std::vector<std::string>& values)
+    {
+        auto cache=engine.create(config.capacity);
+        for (std::size_t i=0;i<config.capacity;i++)
+        {
+            cache->put(values[i],static_cast<int>(i));
+        }
+
+        std::vector<std::vector<Operation>> operations;
+        for (int t=0;t<threads;t++)
+        {
+            operations.push_back(makeOperations(config,static_cast<unsigned>(t+1)));
+        }
+        std::vector<ThreadResult> results(threads);
+        for (auto& result : results)
+        {
+            result.latencies.reserve(config.opsPerThread);
+        }
+
+        std::latch start(threads+1);
+        std::vector<std::thread> workers;
+        for (int t=0;t<threads;t++)
+        {
+            workers.emplace_back([&,t]
+            {
+                ThreadResult& result=results[t];
+                std::string value;
+                start.arrive_and_wait();
+                for (const auto& op : operations[t])
+                {
+                    const auto begin=std::chrono::steady_clock::now();
+                    if (op.isGet)
+                    {
+                        result.gets++;
+                        if (cache->get(op.key,value)) result.hits++;
+                    }
+                    else
+                    {
+                        cache->put(values[op.key],op.key);
+                    }
+                    result.latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-begin).count());
+                }
+            });
+        }
+        start.arrive_and_wait();
+        const auto begin=std::chrono::steady_clock::now();
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        const double seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count();
+
+        std::vector<long long> latencies;
+        long long gets=0;
+        long long hits=0;
+        for (auto& result : results)
+        {
+            latencies.insert(latencies.end(),result.latencies.begin(),result.latencies.end());
+            gets+=result.gets;
+            hits+=result.hits;
+        }
+        std::sort(latencies.begin(),latencies.end());
+        const double opsPerSecond=static_cast<double>(latencies.size())/seconds;
+        const double hitRate=gets==0?0.0:static_cast<double>(hits)/static_cast<double>(gets);
+        // 预热只写满容量，不会淘汰，单线程也不会等锁，所以直接用累计值
+        const AlgorithmStandard::CacheStats stats=cache->stats();
+
+        std::cout<<std::left<<std::setw(16)<<engine.name<<std::right
+                 <<std::setw(8)<<threads
+                 <<std::setw(14)<<std::fixed<<std::setprecision(0)<<opsPerSecond
+                 <<std::setw(10)<<percentile(latencies,0.5)
+                 <<std::setw(10)<<percentile(latencies,0.99)
+                 <<std::setw(10)<<percentile(latencies,0.999)
+                 <<std::setw(10)<<std::setprecision(4)<<hitRate
+                 <<std::setw(12)<<stats.evictions
+                 <<std::setw(12)<<std::setprecision(2)<<static_cast<double>(stats.lockWaitNanos)/1e6<<std::endl;
+    }
+
+    void printUsage()
+    {
+        std::cout<<"用法: CacheBenchmark [--threads 1,2,4,8] [--ops 每线程操作数] [--capacity 容量]"<<std::endl;
+    }
+
+    // 线程数、操作数都存成int：必须是完整的十进制数，并且不超过INT_MAX
+    bool parseInt(const std::string& text,int& value)
+    {
+        std::uint64_t parsed=0;
+        if (!ENGINES::parseCount(text,parsed) || parsed>static_cast<std::uint64_t>(INT_MAX))
+        {
+            return false;
+        }
+        value=static_cast<int>(parsed);
+        return true;
+    }
+
+    // 参数里的数字不合法时打印出错的参数并返回空，由main打印用法
+    std::optional<BenchmarkConfig> parseArguments(const int argc,char* argv[])
+    {
+        BenchmarkConfig config;
+        for (int i=1;i+1<argc;i+=2)
+        {
+            const std::string option=argv[i];
+            const std::string argument=argv[i+1];
+            if (option=="--threads")
+            {
+                config.threadCounts.clear();
+                for (const auto& item : ENGINES::splitList(argument))
+                {
+                    int threads=0;
+                    if (!parseInt(item,threads))
+                    {
+                        std::cout<<"无效的线程数: "<<item<<std::endl;
+                        return std::nullopt;
+                    }
+                    config.threadCounts.push_back(std::max(1,threads));
+                }
+            }
+            else if (option=="--ops")
+            {
+                if (!parseInt(argument,config.opsPerThread))
+                {
+                    std::cout<<"无效的操作数: "<<argument<<std::endl;
+                    return std::nullopt;
+                }
+                config.opsPerThread=std::max(1,config.opsPerThread);
+            }
+            else if (option=="--capacity")
+            {
+                int capacity=0;
+                if (!parseInt(argument,capacity))
+                {
+                    std::cout<<"无效的容量: "<<argument<<std::endl;
+                    return std::nullopt;
+                }
+                config.capacity=static_cast<std::size_t>(std::max(1,capacity));
+            }
+            else std::cout<<"忽略未知参数: "<<option<<std::endl;
+        }
+        return config;
+    }
+
+    void RunBenchmark(const BenchmarkConfig& config)
+    {
+        // value同样提前生成，put时只拷贝字符串，不在计时区间里做格式化
+        std::vector<std::string> values(config.capacity*51);
+        for (std::size_t i=0;i<values.size();i++)
+        {
+            values[i]="value"+std::to_string(i);
+        }
+        std::cout<<"容量: "<<config.capacity<<"  每线程操作数: "<<config.opsPerThread<<"  延迟单位: ns"<<std::endl;
+        std::cout<<std::left<<std::setw(16)<<"算法"<<std::right<<std::setw(8)<<"线程"<<std::setw(14)<<"ops/s"
+                 <<std::setw(10)<<"p50"<<std::setw(10)<<"p99"<<std::setw(10)<<"p99.9"<<std::setw(10)<<"命中率"
+                 <<std::setw(12)<<"淘汰"<<std::setw(12)<<"等锁(ms)"<<std::endl;
+        for (const auto& engine : ENGINES::makeEngines<int,std::string>())
+        {
+            for (const int threads : config.threadCounts)
+            {
+                runOne(engine,threads,config,values);
+            }
+        }
+    }
+}
+
+int main(int argc,char* argv[])
+{
+    const auto config=BENCHMARK::parseArguments(argc,argv);
+    if (!config)
+    {
+        BENCHMARK::printUsage();
+        return 1;
+    }
+    BENCHMARK::RunBenchmark(*config);
+    return 0;
+}
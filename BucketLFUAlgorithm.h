@@ -0,0 +1,261 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <mutex>
+#include "AlgorithmStandard.h"
+
+namespace LFU
+{
+    /*
+    O(1) LFU（经典的“频率桶链表”设计）
+    所有频率桶按频率从小到大串成一条双向链表，每个桶里再挂一条按访问先后排列的节点链表
+    节点被访问时只会移动到“右边相邻”的桶（频率+1，不存在就在旁边新建一个），
+    所以最小频率永远是桶链表的第一个桶，不需要像LFUAlgorithm::UpdateMinfrequency那样扫描
+    节点和桶都放在连续的vector里用下标连接，删掉的槽位串成空闲链表复用，升级频率时没有堆分配
+    这个版本不做老化（aging），需要老化请用LFUAlgorithm
+    */
+    template<typename Key,typename Value>
+    class BucketLFUAlgorithm final : public AlgorithmStandard::Algorithmstandard<Key,Value>
+    {
+        static constexpr std::uint32_t NIL=UINT32_MAX;
+        // 桶链表的哨兵固定在下标0，哨兵的next就是最小频率桶
+        static constexpr std::uint32_t BUCKET_SENTINEL=0;
+
+        struct Node
+        {
+            Key key;
+            Value value;
+            std::uint32_t prev;
+            std::uint32_t next;
+            std::uint32_t bucket; // 节点当前所在的频率桶
+
+            Node(Key key,Value value):key(std::move(key)),value(std::move(value)),prev(NIL),next(NIL),bucket(NIL){}
+        };
+
+        struct Bucket
+        {
+            std::uint32_t frequency;
+            std::uint32_t prev;
+            std::uint32_t next;
+            std::uint32_t head; // 桶内最早进入的节点，同频率时优先淘汰
+            std::uint32_t tail;
+        };
+
+        std::unordered_map<Key,std::uint32_t> cache;
+        std::vector<Node> nodes;
+        std::vector<Bucket> buckets;
+        std::uint32_t freeNode;
+        std::uint32_t freeBucket;
+        std::size_t capacity;
+        AlgorithmStandard::TimedMutex<std::mutex> mutex{this->statistics};
+
+        std::uint32_t allocateNode(Key key,Value value)
+        {
+            if (freeNode!=NIL)
+            {
+                const std::uint32_t index=freeNode;
+                freeNode=nodes[index].next;
+                nodes[index].key=std::move(key);
+                nodes[index].value=std::move(value);
+                nodes[index].prev=NIL;
+                nodes[index].next=NIL;
+                return index;
+            }
+            nodes.emplace_back(std::move(key),std::move(value));
+            return static_cast<std::uint32_t>(nodes.size()-1);
+        }
+        void releaseNode(const std::uint32_t index)
+        {
+            nodes[index].bucket=NIL;
+            nodes[index].next=freeNode;
+            freeNode=index;
+        }
+
+        // 在桶after的右边插入一个频率为frequency的新桶
+        std::uint32_t insertBucketAfter(const std::uint32_t after,const std::uint32_t frequency)
+        {
+            std::uint32_t index;
+            if (freeBucket!=NIL)
+            {
+                index=freeBucket;
+                freeBucket=buckets[index].next;
+            }
+            else
+            {
+                buckets.push_back(Bucket{});
+                index=static_cast<std::uint32_t>(buckets.size()-1);
+            }
+            const std::uint32_t next=buckets[after].next;
+            buckets[index]=Bucket{frequency,after,next,NIL,NIL};
+            buckets[after].next=index;
+            buckets[next].prev=index;
+            return index;
+        }
+        void removeBucket(const std::uint32_t index)
+        {
+            buckets[buckets[index].prev].next=buckets[index].next;
+            buckets[buckets[index].next].prev=buckets[index].prev;
+            buckets[index].next=freeBucket;
+            freeBucket=index;
+        }
+
+        void addNodeToBucketTail(const std::uint32_t bucket,const std::uint32_t index)
+        {
+            Node& node=nodes[index];
+            node.bucket=bucket;
+            node.prev=buckets[bucket].tail;
+            node.next=NIL;
+            if (buckets[bucket].tail!=NIL) nodes[buckets[bucket].tail].next=index;
+            else buckets[bucket].head=index;
+            buckets[bucket].tail=index;
+        }
+        void removeNodeFromBucket(const std::uint32_t index)
+        {
+            Node& node=nodes[index];
+            Bucket& bucket=buckets[node.bucket];
+            if (node.prev!=NIL) nodes[node.prev].next=node.next;
+            else bucket.head=node.next;
+            if (node.next!=NIL) nodes[node.next].prev=node.prev;
+            else bucket.tail=node.prev;
+            node.prev=NIL;
+            node.next=NIL;
+        }
+
+        // 频率+1：移到右边相邻的桶，旧桶空了就回收
+        void NodeFreqUpgrade(const std::uint32_t index)
+        {
+            const std::uint32_t OldBucket=nodes[index].bucket;
+            const std::uint32_t OldFrequency=buckets[OldBucket].frequency;
+            if (OldFrequency==UINT32_MAX)
+            {
+                // 频率已经饱和，只在桶内移到尾部
+                removeNodeFromBucket(index);
+                addNodeToBucketTail(OldBucket,index);
+                return;
+            }
+            std::uint32_t NewBucket=buckets[OldBucket].next;
+            if (NewBucket==BUCKET_SENTINEL || buckets[NewBucket].frequency!=OldFrequency+1)
+            {
+                NewBucket=insertBucketAfter(OldBucket,OldFrequency+1);
+            }
+            removeNodeFromBucket(index);
+            addNodeToBucketTail(NewBucket,index);
+            if (buckets[OldBucket].head==NIL)
+            {
+                removeBucket(OldBucket);
+            }
+        }
+
+        void DeleteOldNode()
+        {
+            CACHE_LATENCY_SCOPE(EVICTION);
+            const std::uint32_t MinBucket=buckets[BUCKET_SENTINEL].next;
+            if (MinBucket==BUCKET_SENTINEL) return;
+            const std::uint32_t NodeToDelete=buckets[MinBucket].head;
+            removeNodeFromBucket(NodeToDelete);
+            if (buckets[MinBucket].head==NIL)
+            {
+                removeBucket(MinBucket);
+            }
+            cache.erase(nodes[NodeToDelete].key);
+            releaseNode(NodeToDelete);
+            this->statistics.record(AlgorithmStandard::StatsEvent::EVICTION);
+        }
+
+        // 调用前key已经在索引里占好位，iter指向这个占位，由调用者的guard在插入完成后release
+        void NewNodeInsert(const typename std::unordered_map<Key,std::uint32_t>::iterator iter,const Key& key,const Value& value)
+        {
+            // key、value先拷贝好再淘汰：拷贝抛出异常时还没有淘汰任何条目，也没有挂上空的频率桶
+            Key NewKey=key;
+            Value NewValue=value;
+            if (cache.size()>capacity)
+            {
+                DeleteOldNode();
+                // 新key已经占了一个位置，所以是大于；unordered_map的erase不会让iter失效
+            }
+            std::uint32_t FirstBucket=buckets[BUCKET_SENTINEL].next;
+            if (FirstBucket==BUCKET_SENTINEL || buckets[FirstBucket].frequency!=1)
+            {
+                FirstBucket=insertBucketAfter(BUCKET_SENTINEL,1);
+            }
+            const std::uint32_t NewIndex=allocateNode(std::move(NewKey),std::move(NewValue));
+            addNodeToBucketTail(FirstBucket,NewIndex);
+            iter->second=NewIndex;
+        }
+
+    public:
+        using AlgorithmStandard::Algorithmstandard<Key,Value>::put;
+        // 右值put使用基类的默认实现（退回到拷贝版本），这里只是避免被下面的put隐藏
+
+        explicit BucketLFUAlgorithm(const std::size_t capacity=DEFAULT_CACHE_CAPACITY):
+            freeNode(NIL),freeBucket(NIL),capacity(capacity)
+        {
+            cache.reserve(capacity+1);
+            // 新key先占位再淘汰，索引里最多同时有capacity+1个key
+            nodes.reserve(capacity);
+            // 非空的桶最多和节点一样多，再加上哨兵和升级时临时多出的一个
+            buckets.reserve(capacity+2);
+            buckets.push_back(Bucket{0,BUCKET_SENTINEL,BUCKET_SENTINEL,NIL,NIL});
+        }
+        ~BucketLFUAlgorithm() override=default;
+
+        bool get(const Key& key, Value& value) override
+        {
+            CACHE_LATENCY_SCOPE(GET);
+            std::lock_guard lock(mutex);
+            auto iter=cache.find(key);
+            if (iter==cache.end())
+            {
+                return this->recordLookup(false);
+            }
+            NodeFreqUpgrade(iter->second);
+            value=nodes[iter->second].value;
+            return this->recordLookup(true);
+        }
+
+        void put(const Value& val,const Key& key) override
+        {
+            CACHE_LATENCY_SCOPE(PUT);
+            std::lock_guard lock(mutex);
+            auto [iter,inserted]=cache.try_emplace(key,NIL);
+            this->recordPut(!inserted);
+            if (!inserted)
+            {
+                nodes[iter->second].value=val;
+                NodeFreqUpgrade(iter->second);
+                return;
+            }
+            // 先在索引里占位，插入途中抛出异常或者容量为0放弃插入时由guard撤销
+            AlgorithmStandard::PlaceholderGuard placeholder(cache,iter);
+            if (capacity==0)
+            {
+                return;
+            }
+            NewNodeInsert(iter,key,val);
+            placeholder.release();
+        }
+
+        // 缩小时从最小频率桶的头部逐个淘汰，扩大时一次性reserve
+        void resize(const std::size_t newCapacity)
+        {
+            std::lock_guard lock(mutex);
+            capacity=newCapacity;
+            while (cache.size()>capacity)
+            {
+                DeleteOldNode();
+            }
+            cache.reserve(capacity+1);
+            nodes.reserve(capacity);
+            buckets.reserve(capacity+2);
+        }
+
+        std::size_t getCapacity()
+        {
+            std::lock_guard lock(mutex);
+            return capacity;
+        }
+    };
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#include "AlgorithmStandard.h"
+#include "LRUAlgorithm.h"
+#include "ShardedLRUAlgorithm.h"
+#include "LFUAlgorithm.h"
+#include "BucketLFUAlgorithm.h"
+#include "WTinyLFUAlgorithm.h"
+#include "ARCAlgorithm.h"
+#include "ClockAlgorithm.h"
+#include "LRUKAlgorithm.h"
+#include "TwoQAlgorithm.h"
+#include "S3FIFOAlgorithm.h"
+#include "PolicyCache.h"
+
+/*
+多线程吞吐测试和访问日志回放共用的算法列表，以及两个工具解析命令行参数用的小函数
+新增算法只需要在这里加一行，两个工具都会带上它，名字也保持一致（--engines按这里的名字筛选）
+*/
+namespace ENGINES
+{
+    template<typename Key,typename Value>
+    struct Engine
+    {
+        std::string name;
+        std::function<std::unique_ptr<AlgorithmStandard::Algorithmstandard<Key,Value>>(std::size_t)> create;
+    };
+
+    // 把 "1,2,4" 这样的参数按逗号拆开，空的项跳过
+    inline std::vector<std::string> splitList(const std::string& text)
+    {
+        std::vector<std::string> items;
+        std::size_t begin=0;
+        while (begin<=text.size())
+        {
+            const std::size_t end=std::min(text.find(',',begin),text.size());
+            if (end>begin)
+            {
+                items.push_back(text.substr(begin,end-begin));
+            }
+            begin=end+1;
+        }
+        return items;
+    }
+
+    // 整段都是十进制数字才算合法；std::stoi、std::stoull会接受"12abc"、"-1"这样的输入，不合法时还会抛出异常
+    inline bool parseCount(const std::string_view text,std::uint64_t& value)
+    {
+        const auto [rest,error]=std::from_chars(text.data(),text.data()+text.size(),value);
+        return error==std::errc() && rest==text.data()+text.size() && !text.empty();
+    }
+
+    template<typename Key,typename Value>
+    std::vector<Engine<Key,Value>> makeEngines()
+    {
+        return {
+            {"LRU",[](std::size_t c){return std::make_unique<LRU::LRUAlgorithm<Key,Value>>(c);}},
+            {"LazyLRU",[](std::size_t c){return std::make_unique<LRU::LazyLRUAlgorithm<Key,Value>>(c);}},
+            {"ShardedLRU<16>",[](std::size_t c){return std::make_unique<LRU::ShardedLRU<Key,Value,16>>(c);}},
+            {"LFU",[](std::size_t c){return std::make_unique<LFU::LFUAlgorithm<Key,Value>>(INT_MAX,c);}},
+            {"LFU-Aging",[](std::size_t c){return std::make_unique<LFU::LFUAlgorithm<Key,Value>>(100,c);}},
+            {"BucketLFU",[](std::size_t c){return std::make_unique<LFU::BucketLFUAlgorithm<Key,Value>>(c);}},
+            {"W-TinyLFU",[](std::size_t c){return std::make_unique<TinyLFU::WTinyLFUAlgorithm<Key,Value>>(c);}},
+            {"ARC",[](std::size_t c){return std::make_unique<ARC::ARCAlgorithm<Key,Value>>(c);}},
+            {"CLOCK",[](std::size_t c){return std::make_unique<Clock::ClockAlgorithm<Key,Value>>(c);}},
+            {"SIEVE",[](std::size_t c){return std::make_unique<Clock::SieveAlgorithm<Key,Value>>(c);}},
+            {"LRU-2",[](std::size_t c){return std::make_unique<LRU::LRUKAlgorithm<Key,Value>>(c);}},
+            {"2Q",[](std::size_t c){return std::make_unique<TwoQ::TwoQAlgorithm<Key,Value>>(c);}},
+            {"S3-FIFO",[](std::size_t c){return std::make_unique<S3FIFO::S3FIFOAlgorithm<Key,Value>>(c);}},
+            {"PolicyLRU",[](std::size_t c){return std::make_unique<Policy::VirtualCache<Policy::Cache<Policy::LRUPolicy,Key,Value>>>(c);}},
+        };
+    }
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace AlgorithmStandard
+{
+    // stats()返回的快照，各项都是从缓存创建以来的累计值
+    struct CacheStats
+    {
+        std::uint64_t hits=0;
+        std::uint64_t misses=0;
+        std::uint64_t puts=0;        // 所有写入（包括覆盖已有的key）
+        std::uint64_t updates=0;     // 其中覆盖已有key的次数
+        std::uint64_t evictions=0;   // 因为容量不够被淘汰的条目（不包括TTL过期）
+        std::uint64_t expirations=0; // 因为TTL过期被回收的条目
+        std::uint64_t agingPasses=0; // LFU老化（ReduceAllNodeFrequency）执行的次数
+        std::uint64_t lockWaits=0;   // 加锁时锁已被占用、需要等待的次数
+        std::uint64_t lockWaitNanos=0; // 这些等待的总耗时（纳秒）
+
+        double hitRate() const
+        {
+            const std::uint64_t lookups=hits+misses;
+            return lookups==0?0.0:static_cast<double>(hits)/static_cast<double>(lookups);
+        }
+
+        CacheStats& operator+=(const CacheStats& other)
+        {
+            hits+=other.hits;
+            misses+=other.misses;
+            puts+=other.puts;
+            updates+=other.updates;
+            evictions+=other.evictions;
+            expirations+=other.expirations;
+            agingPasses+=other.agingPasses;
+            lockWaits+=other.lockWaits;
+            lockWaitNanos+=other.lockWaitNanos;
+            return *this;
+        }
+    };
+
+    enum class StatsEvent : std::uint8_t
+    {
+        HIT,
+        MISS,
+        PUT,
+        UPDATE,
+        EVICTION,
+        EXPIRATION,
+        AGING,
+        LOCK_WAIT,
+        LOCK_WAIT_NANOS,
+        COUNT
+    };
+
+    /*
+    分条（striped）计数器：STRIPES份计数器各占独立的缓存行，每个线程第一次计数时轮流分到其中一份
+    计数是对自己那一份的relaxed原子加，线程数不超过STRIPES时没有两个线程写同一条缓存行，
+    命中路径上不会出现所有线程争同一个原子变量的情况；读取快照时再把所有份加起来
+    */
+    class StatsCounter
+    {
+        static constexpr std::size_t STRIPES=16;
+        static constexpr std::size_t EVENTS=static_cast<std::size_t>(StatsEvent::COUNT);
+
+        struct alignas(64) Stripe
+        {
+            std::array<std::atomic<std::uint64_t>,EVENTS> counters{};
+        };
+
+        std::array<Stripe,STRIPES> stripes;
+        // 当前线程处在UncountedLookups作用域内时为true
+        static inline thread_local bool lookupsPaused=false;
+        friend class UncountedLookups;
+
+        static std::size_t stripeIndex()
+        {
+            static std::atomic<std::size_t> nextStripe{0};
+            thread_local const std::size_t index=nextStripe.fetch_add(1,std::memory_order_relaxed)%STRIPES;
+            return index;
+        }
+
+    public:
+        void record(const StatsEvent event,const std::uint64_t count=1)
+        {
+            if (lookupsPaused && (event==StatsEvent::HIT || event==StatsEvent::MISS))
+            {
+                return;
+            }
+            stripes[stripeIndex()].counters[static_cast<std::size_t>(event)].fetch_add(count,std::memory_order_relaxed);
+        }
+
+        // 读取过程中其他线程仍在计数，各项之间不保证是同一时刻的值
+        CacheStats snapshot() const
+        {
+            std::array<std::uint64_t,EVENTS> total{};
+            for (const auto& stripe : stripes)
+            {
+                for (std::size_t i=0;i<EVENTS;i++)
+                {
+                    total[i]+=stripe.counters[i].load(std::memory_order_relaxed);
+                }
+            }
+            CacheStats stats;
+            stats.hits=total[static_cast<std::size_t>(StatsEvent::HIT)];
+            stats.misses=total[static_cast<std::size_t>(StatsEvent::MISS)];
+            stats.puts=total[static_cast<std::size_t>(StatsEvent::PUT)];
+            stats.updates=total[static_cast<std::size_t>(StatsEvent::UPDATE)];
+            stats.evictions=total[static_cast<std::size_t>(StatsEvent::EVICTION)];
+            stats.expirations=total[static_cast<std::size_t>(StatsEvent::EXPIRATION)];
+            stats.agingPasses=total[static_cast<std::size_t>(StatsEvent::AGING)];
+            stats.lockWaits=total[static_cast<std::size_t>(StatsEvent::LOCK_WAIT)];
+            stats.lockWaitNanos=total[static_cast<std::size_t>(StatsEvent::LOCK_WAIT_NANOS)];
+            return stats;
+        }
+    };
+
+    /*
+    作用域内当前线程的查找不计入命中、未命中，其他事件照常计数
+    getOrLoad/getAsync的leader抢到加载权后会再查一次缓存，这次查找和调用者前面那次未命中是同一次访问，不能再算一次
+    */
+    class UncountedLookups
+    {
+        bool previous;
+
+    public:
+        UncountedLookups():previous(StatsCounter::lookupsPaused)
+        {
+            StatsCounter::lookupsPaused=true;
+        }
+        ~UncountedLookups()
+        {
+            StatsCounter::lookupsPaused=previous;
+        }
+        UncountedLookups(const UncountedLookups&)=delete;
+        UncountedLookups& operator=(const UncountedLookups&)=delete;
+    };
+
+    /*
+    记录等锁时间的互斥量包装，用法和被包装的互斥量一样（lock_guard、shared_lock都可以直接用）
+    先try_lock，拿到了就直接返回，不读时钟；只有锁被占用时才计时并阻塞等待，所以不争锁时没有额外开销
+    被包装的是shared_mutex时同样提供共享加锁
+    */
+    template<typename Mutex>
+    class TimedMutex
+    {
+        Mutex mutex;
+        StatsCounter& stats;
+
+        void recordWait(const std::chrono::steady_clock::time_point start)
+        {
+            const auto waited=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-start).count();
+            stats.record(StatsEvent::LOCK_WAIT);
+            stats.record(StatsEvent::LOCK_WAIT_NANOS,static_cast<std::uint64_t>(waited));
+        }
+
+    public:
+        explicit TimedMutex(StatsCounter& stats):stats(stats){}
+
+        void lock()
+        {
+            if (mutex.try_lock())
+            {
+                return;
+            }
+            const auto start=std::chrono::steady_clock::now();
+            mutex.lock();
+            recordWait(start);
+        }
+        bool try_lock()
+        {
+            return mutex.try_lock();
+        }
+        void unlock()
+        {
+            mutex.unlock();
+        }
+
+        void lock_shared() requires requires(Mutex& m){m.lock_shared();}
+        {
+            if (mutex.try_lock_shared())
+            {
+                return;
+            }
+            const auto start=std::chrono::steady_clock::now();
+            mutex.lock_shared();
+            recordWait(start);
+        }
+        bool try_lock_shared() requires requires(Mutex& m){m.try_lock_shared();}
+        {
+            return mutex.try_lock_shared();
+        }
+        void unlock_shared() requires requires(Mutex& m){m.unlock_shared();}
+        {
+            mutex.unlock_shared();
+        }
+    };
+}
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+#include "AlgorithmStandard.h"
+#include "FlatIndex.h"
+#include "LRUAlgorithm.h"
+
+namespace Clock
+{
+    // 访问位的读写：读路径只拿共享锁，多个读线程会同时写同一个访问位，所以一律通过atomic_ref
+    inline void markVisited(std::uint8_t& visited)
+    {
+        std::atomic_ref<std::uint8_t> bit(visited);
+        if (bit.load(std::memory_order_relaxed)==0)
+        {
+            bit.store(1,std::memory_order_relaxed);
+            // 已经置过就不再写，避免多个核反复争同一条缓存行
+        }
+    }
+
+    inline bool testAndClearVisited(std::uint8_t& visited)
+    {
+        std::atomic_ref<std::uint8_t> bit(visited);
+        if (bit.load(std::memory_order_relaxed)==0)
+        {
+            return false;
+        }
+        bit.store(0,std::memory_order_relaxed);
+        return true;
+    }
+
+    /*
+    CLOCK：所有条目放在一个固定大小的环形槽位数组里，指针（hand）沿着数组转圈
+    命中只置访问位，不移动任何东西；读路径只拿shared_mutex的共享锁
+    淘汰时hand指向的槽位访问位为1就清零继续往前走（second chance），遇到访问位为0的槽位就把新key原地写进去
+    没满时新key追加在数组末尾；满了之后槽位数组不再变化，淘汰和插入都是同一个槽位上的原地替换
+    */
+    template<typename Key,typename Value>
+    class ClockAlgorithm final : public AlgorithmStandard::Algorithmstandard<Key,Value>
+    {
+        struct Slot
+        {
+            Key key;
+            Value value;
+            std::uint8_t visited;
+        };
+
+        using Index=AlgorithmStandard::FlatIndex<Key,std::uint32_t>;
+
+        Index cache; // key到槽位下标
+        std::vector<Slot> slots;
+        std::size_t capacity;
+        std::size_t hand;
+        AlgorithmStandard::TimedMutex<std::shared_mutex> mutex{this->statistics};
+
+        // 转到第一个访问位为0的槽位，每个槽位最多被跳过一次，最多转一圈
+        std::uint32_t findVictim()
+        {
+            CACHE_LATENCY_SCOPE(EVICTION);
+            while (testAndClearVisited(slots[hand].visited))
+            {
+                hand=hand+1==slots.size()?0:hand+1;
+            }
+            const std::size_t victim=hand;
+            hand=hand+1==slots.size()?0:hand+1;
+            return static_cast<std::uint32_t>(victim);
+        }
+
+        template<typename V>
+        void putValue(V&& val,const Key& key)
+        {
+            CACHE_LATENCY_SCOPE(PUT);
+            std::lock_guard lock(mutex);
+            if (capacity==0)
+            {
+                return;
+            }
+            auto [iter,inserted]=cache.try_emplace(key,0);
+            this->recordPut(!inserted);
+            if (!inserted)
+            {
+                Slot& slot=slots[iter->second];
+                slot.value=std::forward<V>(val);
+                markVisited(slot.visited);
+                return;
+            }
+            // 新槽位先构造好再动淘汰者：拷贝key、value抛出异常时只需要由guard撤销占位
+            AlgorithmStandard::PlaceholderGuard placeholder(cache,iter);
+            Slot fresh{key,std::forward<V>(val),0};
+            if (slots.size()<capacity)
+            {
+                iter->second=static_cast<std::uint32_t>(slots.size());
+                slots.push_back(std::move(fresh));
+                placeholder.release();
+                return;
+            }
+            const std::uint32_t victim=findVictim();
+            cache.erase(slots[victim].key);
+            this->statistics.record(AlgorithmStandard::StatsEvent::EVICTION);
+            // FlatIndex的erase不会移动其他元素，iter仍然有效
+            iter->second=victim;
+            slots[victim]=std::move(fresh);
+            placeholder.release();
+        }
+
+    public:
+        explicit ClockAlgorithm(const std::size_t capacity=DEFAULT_CACHE_CAPACITY):capacity(capacity),hand(0)
+        {
+            cache.reserve(capacity+1);
+            slots.reserve(capacity);
+        }
+        ~ClockAlgorithm() override=default;
+
+        bool get(const Key& key, Value& value) override
+        {
+            CACHE_LATENCY_SCOPE(GET);
+            std::shared_lock lock(mutex);
+            auto iter=cache.find(key);
+            if (iter==cache.end())
+            {
+                return this->recordLookup(false);
+            }
+            Slot& slot=slots[iter->second];
+            value=slot.value;
+            markVisited(slot.visited);
+            return this->recordLookup(true);
+        }
+
+        void put(const Value& val,const Key& key) override
+        {
+            putValue(val,key);
+        }
+
+        void put(Value&& val,const Key& key) override
+        {
+            putValue(std::move(val),key);
+        }
+
+        std::size_t getCapacity()
+        {
+            std::shared_lock lock(mutex);
+            return capacity;
+        }
+    };
+
+    /*
+    SIEVE：和CLOCK一样命中只置访问位，区别在于队列顺序
+    新key总是插入到队列的最新一端，hand从最旧一端往新的一端走，被淘汰的节点直接从队列中间摘掉，
+    留下来的节点保持原来的相对位置（CLOCK会把新key放进被淘汰者的位置，打乱进入顺序）
+    这样只访问过一次的新条目很快被淘汰，反复命中的条目长期留在hand后面，对热点负载的命中率接近甚至高于LRU
+    节点放在LRUNodePool的连续数组里用下标连接，访问位就是节点的accessed字段
+    */
+    template<typename Key,typename Value>
+    class SieveAlgorithm final : public AlgorithmStandard::Algorithmstandard<Key,Value>
+    {
+        static constexpr std::uint32_t QUEUE=0;
+        // 链表头部（哨兵的next）是最旧的节点，尾部是最新的节点
+
+        using Index=AlgorithmStandard::FlatIndex<Key,std::uint32_t>;
+
+        Index cache;
+        LRU::LRUNodePool<Key,Value> pool;
+        std::size_t capacity;
+        std::uint32_t hand; // 下一次淘汰从这里开始看，NIL_INDEX表示从最旧的节点开始
+        AlgorithmStandard::TimedMutex<std::shared_mutex> mutex{this->statistics};
+
+        void evict()
+        {
+            CACHE_LATENCY_SCOPE(EVICTION);
+            std::uint32_t index=hand==LRU::NIL_INDEX?pool.first(QUEUE):hand;
+            while (testAndClearVisited(pool[index].accessed))
+            {
+                index=pool[index].next;
+                if (index==QUEUE)
+                {
+                    index=pool.first(QUEUE);
+                    // 走到最新一端后回到最旧一端
+                }
+            }
+            const std::uint32_t next=pool[index].next;
+            hand=next==QUEUE?LRU::NIL_INDEX:next;
+            cache.erase(pool[index].key);
+            pool.removeNode(index);
+            pool.release(index);
+            this->statistics.record(AlgorithmStandard::StatsEvent::EVICTION);
+        }
+
+        template<typename V>
+        void putValue(V&& val,const Key& key)
+        {
+            CACHE_LATENCY_SCOPE(PUT);
+            std::lock_guard lock(mutex);
+            if (capacity==0)
+            {
+                return;
+            }
+            auto [iter,inserted]=cache.try_emplace(key,LRU::NIL_INDEX);
+            this->recordPut(!inserted);
+            if (!inserted)
+            {
+                pool[iter->second].value=std::forward<V>(val);
+                markVisited(pool[iter->second].accessed);
+                return;
+            }
+            // key、value先拷贝好再淘汰：拷贝抛出异常时缓存没有任何变化，只需要由guard撤销占位
+            AlgorithmStandard::PlaceholderGuard placeholder(cache,iter);
+            Key NewKey=key;
+            Value NewValue(std::forward<V>(val));
+            if (cache.size()>capacity)
+            {
+                evict();
+                // 新key已经占了一个位置，所以是大于；淘汰后立刻复用刚释放的节点
+            }
+            const std::uint32_t NewIndex=pool.allocate(std::move(NewKey),std::move(NewValue));
+            iter->second=NewIndex;
+            pool.addNodeToLast(QUEUE,NewIndex);
+            placeholder.release();
+        }
+
+    public:
+        explicit SieveAlgorithm(const std::size_t capacity=DEFAULT_CACHE_CAPACITY):
+            pool(capacity),capacity(capacity),hand(LRU::NIL_INDEX)
+        {
+            cache.reserve(capacity+1);
+        }
+        ~SieveAlgorithm() override=default;
+
+        bool get(const Key& key, Value& value) override
+        {
+            CACHE_LATENCY_SCOPE(GET);
+            std::shared_lock lock(mutex);
+            auto iter=cache.find(key);
+            if (iter==cache.end())
+            {
+                return this->recordLookup(false);
+            }
+            value=pool[iter->second].value;
+            markVisited(pool[iter->second].accessed);
+            return this->recordLookup(true);
+        }
+
+        void put(const Value& val,const Key& key) override
+        {
+            putValue(val,key);
+        }
+
+        void put(Value&& val,const Key& key) override
+        {
+            putValue(std::move(val),key);
+        }
+
+        std::size_t getCapacity()
+        {
+            std::shared_lock lock(mutex);
+            return capacity;
+        }
+    };
+}
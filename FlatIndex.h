@@ -0,0 +1,321 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <utility>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#include <emmintrin.h>
+#define FLAT_INDEX_SSE2 1
+#endif
+
+namespace AlgorithmStandard
+{
+    /*
+    开放寻址的扁平哈希索引（Swiss table的做法），代替std::unordered_map做key到节点的索引
+    所有(key,value)直接放在一段连续数组里，没有链表节点，查找不需要额外的指针跳转
+    每个槽位另有一个控制字节：空(EMPTY)，或者哈希值的低7位(H2)
+    槽位按16个一组，查找时一次比较整组16个控制字节（有SSE2时用一条指令，没有时逐字节比较），只有H2相同的槽位才去比较key
+    每组另有一个溢出计数：探测时经过这一组（这一组当时已满）、放到后面组里的元素个数
+    查找走到溢出计数为0的组就可以停下；删除时把元素探测路径上各组的溢出计数减回去，槽位直接标记为空
+    没有“已删除”标记，持续插入、删除不会积累墓碑，只有有效元素超过7/8时才扩容
+
+    和std::unordered_map的区别：
+    1. 迭代器只用于find/try_emplace的结果，不支持遍历
+    2. erase不会移动其他元素，其他元素的迭代器和地址保持有效；插入触发扩容时所有迭代器和地址失效
+    3. reserve(n)之后，无论中间删除、插入多少次，只要元素个数不超过n就不会再扩容或重建
+    */
+    template<typename Key,typename Mapped,typename Hash=std::hash<Key>,typename KeyEqual=std::equal_to<Key>>
+    class FlatIndex
+    {
+    public:
+        using value_type=std::pair<Key,Mapped>;
+
+        class iterator
+        {
+            value_type* slot;
+
+        public:
+            explicit iterator(value_type* slot=nullptr):slot(slot){}
+            value_type& operator*() const
+            {
+                return *slot;
+            }
+            value_type* operator->() const
+            {
+                return slot;
+            }
+            bool operator==(const iterator& other) const=default;
+
+            friend class FlatIndex;
+        };
+
+    private:
+        static constexpr std::size_t GROUP_SIZE=16;
+        static constexpr std::int8_t EMPTY=-128;
+        // 有效槽位的控制字节是0~127
+
+        std::unique_ptr<std::int8_t[]> ctrl;
+        std::unique_ptr<std::uint32_t[]> overflow; // 每组一个溢出计数
+        value_type* slots;
+        std::size_t capacity; // 槽位数，16的倍数，组数是2的幂
+        std::size_t count;
+        [[no_unique_address]] Hash hasher;
+        [[no_unique_address]] KeyEqual equal;
+
+        // 组内控制字节等于value的位置，第i位对应组内第i个槽位
+        static std::uint32_t match(const std::int8_t* group,const std::int8_t value)
+        {
+#ifdef FLAT_INDEX_SSE2
+            const __m128i bytes=_mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+            return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes,_mm_set1_epi8(value))));
+#else
+            std::uint32_t mask=0;
+            for (std::size_t i=0;i<GROUP_SIZE;i++)
+            {
+                if (group[i]==value) mask|=1u<<i;
+            }
+            return mask;
+#endif
+        }
+
+        std::uint64_t hashOf(const Key& key) const
+        {
+            // std::hash<int>是恒等映射，用splitmix64的收尾步骤打散，让H1和H2都用上所有位
+            std::uint64_t x=static_cast<std::uint64_t>(hasher(key));
+            x^=x>>30;
+            x*=0xBF58476D1CE4E5B9ULL;
+            x^=x>>27;
+            x*=0x94D049BB133111EBULL;
+            x^=x>>31;
+            return x;
+        }
+        static std::int8_t h2Of(const std::uint64_t hash)
+        {
+            return static_cast<std::int8_t>(hash&0x7F);
+        }
+        std::size_t groupMask() const
+        {
+            return capacity/GROUP_SIZE-1;
+        }
+        std::size_t maxLoad() const
+        {
+            return capacity-capacity/8;
+        }
+
+        // 按组做三角数探测，组数是2的幂时前“组数”步恰好访问每一组一次；找不到返回capacity
+        std::size_t findIndex(const Key& key,const std::uint64_t hash) const
+        {
+            if (capacity==0)
+            {
+                return capacity;
+            }
+            const std::int8_t h2=h2Of(hash);
+            std::size_t group=(hash>>7)&groupMask();
+            for (std::size_t step=1;step<=groupMask()+1;step++)
+            {
+                const std::int8_t* bytes=ctrl.get()+group*GROUP_SIZE;
+                for (std::uint32_t mask=match(bytes,h2);mask!=0;mask&=mask-1)
+                {
+                    const std::size_t index=group*GROUP_SIZE+std::countr_zero(mask);
+                    if (equal(slots[index].first,key))
+                    {
+                        return index;
+                    }
+                }
+                if (overflow[group]==0)
+                {
+                    // 没有元素经过这一组放到后面，要找的key不可能在更后面
+                    return capacity;
+                }
+                group=(group+step)&groupMask();
+            }
+            return capacity;
+        }
+        // 探测序列上第一个有空槽的组里的空槽；有效元素不超过7/8，一定能找到
+        static std::size_t findFreeIndex(const std::int8_t* ctrl,const std::size_t groupMask,const std::uint64_t hash)
+        {
+            std::size_t group=(hash>>7)&groupMask;
+            for (std::size_t step=1;;step++)
+            {
+                const std::uint32_t mask=match(ctrl+group*GROUP_SIZE,EMPTY);
+                if (mask!=0)
+                {
+                    return group*GROUP_SIZE+std::countr_zero(mask);
+                }
+                group=(group+step)&groupMask;
+            }
+        }
+        // 探测路径上，从起始组到元素所在组（不含）的每一组溢出计数加delta：插入时+1，删除时-1
+        static void addOverflow(std::uint32_t* overflow,const std::size_t groupMask,const std::uint64_t hash,const std::size_t target,const std::uint32_t delta)
+        {
+            std::size_t group=(hash>>7)&groupMask;
+            for (std::size_t step=1;group!=target;step++)
+            {
+                overflow[group]+=delta;
+                group=(group+step)&groupMask;
+            }
+        }
+
+        /*
+        先分配好新的数组再搬迁，分配失败（bad_alloc）时原来的表原样保留
+        元素的移动构造不会抛出异常时直接移动，否则拷贝，拷贝中途抛出异常时销毁已经拷贝的部分，原来的表同样不变
+        */
+        void rehash(const std::size_t newCapacity)
+        {
+            const std::size_t newGroups=newCapacity/GROUP_SIZE;
+            const std::size_t newGroupMask=newGroups-1;
+            auto newCtrl=std::make_unique<std::int8_t[]>(newCapacity);
+            std::fill_n(newCtrl.get(),newCapacity,EMPTY);
+            auto newOverflow=std::make_unique<std::uint32_t[]>(newGroups);
+            value_type* newSlots=std::allocator<value_type>().allocate(newCapacity);
+            try
+            {
+                for (std::size_t i=0;i<capacity;i++)
+                {
+                    if (ctrl[i]<0) continue;
+                    const std::uint64_t hash=hashOf(slots[i].first);
+                    const std::size_t index=findFreeIndex(newCtrl.get(),newGroupMask,hash);
+                    std::construct_at(newSlots+index,std::move_if_noexcept(slots[i]));
+                    newCtrl[index]=ctrl[i];
+                    addOverflow(newOverflow.get(),newGroupMask,hash,index/GROUP_SIZE,1);
+                }
+            }
+            catch (...)
+            {
+                for (std::size_t i=0;i<newCapacity;i++)
+                {
+                    if (newCtrl[i]>=0) std::destroy_at(newSlots+i);
+                }
+                std::allocator<value_type>().deallocate(newSlots,newCapacity);
+                throw;
+            }
+            for (std::size_t i=0;i<capacity;i++)
+            {
+                if (ctrl[i]>=0) std::destroy_at(slots+i);
+            }
+            if (slots!=nullptr)
+            {
+                std::allocator<value_type>().deallocate(slots,capacity);
+            }
+            ctrl=std::move(newCtrl);
+            overflow=std::move(newOverflow);
+            slots=newSlots;
+            capacity=newCapacity;
+        }
+
+        // try_emplace的实现，K是const Key&或Key：key已存在时不会被移动
+        template<typename K,typename... Args>
+        std::pair<iterator,bool> emplaceKey(K&& key,Args&&... args)
+        {
+            const std::uint64_t hash=hashOf(key);
+            const std::size_t found=findIndex(key,hash);
+            if (found!=capacity)
+            {
+                return {iterator(slots+found),false};
+            }
+            if (count+1>maxLoad())
+            {
+                rehash(capacityFor(capacity));
+            }
+            const std::size_t index=findFreeIndex(ctrl.get(),groupMask(),hash);
+            // 先构造再标记控制字节、修改溢出计数：构造抛出异常时表没有任何变化
+            std::construct_at(slots+index,std::piecewise_construct,std::forward_as_tuple(std::forward<K>(key)),std::forward_as_tuple(std::forward<Args>(args)...));
+            ctrl[index]=h2Of(hash);
+            addOverflow(overflow.get(),groupMask(),hash,index/GROUP_SIZE,1);
+            count++;
+            return {iterator(slots+index),true};
+        }
+
+        // 至少能放下n个元素的槽位数
+        static std::size_t capacityFor(const std::size_t n)
+        {
+            return std::bit_ceil(std::max(GROUP_SIZE,n+n/7+1));
+        }
+
+    public:
+        FlatIndex():slots(nullptr),capacity(0),count(0){}
+        FlatIndex(const FlatIndex&)=delete;
+        FlatIndex& operator=(const FlatIndex&)=delete;
+        ~FlatIndex()
+        {
+            for (std::size_t i=0;i<capacity;i++)
+            {
+                if (ctrl[i]>=0) std::destroy_at(slots+i);
+            }
+            if (slots!=nullptr)
+            {
+                std::allocator<value_type>().deallocate(slots,capacity);
+            }
+        }
+
+        iterator end() const
+        {
+            return iterator();
+        }
+
+        std::size_t size() const
+        {
+            return count;
+        }
+
+        iterator find(const Key& key)
+        {
+            const std::size_t index=findIndex(key,hashOf(key));
+            return index==capacity?end():iterator(slots+index);
+        }
+
+        bool contains(const Key& key) const
+        {
+            return findIndex(key,hashOf(key))!=capacity;
+        }
+
+        // 和std::unordered_map::try_emplace一样：key已存在时返回它和false，否则用args构造value
+        template<typename... Args>
+        std::pair<iterator,bool> try_emplace(const Key& key,Args&&... args)
+        {
+            return emplaceKey(key,std::forward<Args>(args)...);
+        }
+        // 右值key只在真正插入时才移动进槽位，key已存在时保持不变
+        template<typename... Args>
+        std::pair<iterator,bool> try_emplace(Key&& key,Args&&... args)
+        {
+            return emplaceKey(std::move(key),std::forward<Args>(args)...);
+        }
+
+        void erase(const iterator iter)
+        {
+            const std::size_t index=static_cast<std::size_t>(iter.slot-slots);
+            // 探测路径上经过的组不再有这个元素溢出过去，槽位可以直接标记为空
+            addOverflow(overflow.get(),groupMask(),hashOf(iter->first),index/GROUP_SIZE,static_cast<std::uint32_t>(-1));
+            std::destroy_at(iter.slot);
+            ctrl[index]=EMPTY;
+            count--;
+        }
+
+        std::size_t erase(const Key& key)
+        {
+            const iterator iter=find(key);
+            if (iter==end())
+            {
+                return 0;
+            }
+            erase(iter);
+            return 1;
+        }
+
+        // 一次性扩到能放下n个元素，之后插入到n个为止都不会扩容
+        void reserve(const std::size_t n)
+        {
+            const std::size_t needed=capacityFor(n);
+            if (needed>capacity)
+            {
+                rehash(needed);
+            }
+        }
+    };
+}
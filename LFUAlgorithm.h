@@ -1,47 +1,92 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <climits>
+#include <cstdint>
+#include <iterator>
+#include <map>
 #include <memory>
-#include <unordered_map>
+#include <memory_resource>
+#include <new>
+#include <utility>
+#include <vector>
 #include <mutex>
 #include "AlgorithmStandard.h"
+#include "FlatIndex.h"
+#include "TimerWheel.h"
 
 namespace LFU
 {
-    template<typename Key,typename Value>
+    template<typename Key,typename Value,bool SharedValues>
     class LFUAlgorithm;
 
+    /*
+    频率和频率总和用64位有符号整数
+    原始频率每次访问最多加1，老化只会增大偏移量，按每秒10亿次操作算也要几百年才会溢出，实际使用中不会遇到
+    */
+    using Frequency=std::int64_t;
+
+    // Value是节点里实际保存的类型：LFUAlgorithm默认保存value本身，SharedValues=true时保存value的shared_ptr
     template <typename Key,typename Value>
     struct Node
     {
         Key key;
         Value value;
-        int NodeFrequency; // 表示节点访问频率
+        Frequency NodeFrequency; // 表示节点访问频率
+        std::uint32_t Weight; // 节点占用的容量，没有设置权重函数时为1
+        std::uint64_t ExpireTick; // TTL过期时刻（TimerWheel的tick），0表示不过期
+        TTL::TimerHandle Timer; // 时间轮里的条目，覆盖或删除节点时用它取消；NO_TIMER表示没有
         std::shared_ptr<Node> next;
         std::weak_ptr<Node> prev;
 
         // std::weakptr不能直接由nullptr构造,默认构造即为空
-        Node():NodeFrequency(1),next(nullptr){}
-        Node(Key key,Value value):key(key),value(value),NodeFrequency(1),next(nullptr){}
+        Node():NodeFrequency(1),Weight(1),ExpireTick(0),Timer(TTL::NO_TIMER),next(nullptr){}
+        Node(Key key,Value value):key(std::move(key)),value(std::move(value)),NodeFrequency(1),Weight(1),ExpireTick(0),
+            Timer(TTL::NO_TIMER),next(nullptr){}
     };
 
     template <typename Key,typename Value>
     class FreqList
     {
-        int ListFrequency; // 表示这条链表所对应的访问频率
+        Frequency ListFrequency; // 表示这条链表所对应的访问频率
+        int NodeCount; // 链表中的节点数，老化时按链表整体计算减少的总频次
         std::shared_ptr<Node<Key,Value>> head;
         std::shared_ptr<Node<Key,Value>> tail;
         // 不需要专门的capacityUsage，检查KeyValue索引的HashMap的大小即可
 
         public:
-        explicit FreqList(const int freq)
+        // 两个哨兵节点从resource分配，LFUAlgorithm传入自己的节点池
+        explicit FreqList(const Frequency freq,std::pmr::memory_resource* resource=std::pmr::get_default_resource())
         {
             ListFrequency=freq;
-            head=std::make_shared<Node<Key,Value>>();
-            tail=std::make_shared<Node<Key,Value>>();
+            NodeCount=0;
+            const std::pmr::polymorphic_allocator<Node<Key,Value>> allocator(resource);
+            head=std::allocate_shared<Node<Key,Value>>(allocator);
+            tail=std::allocate_shared<Node<Key,Value>>(allocator);
             head->next=tail;
             tail->prev=std::weak_ptr<Node<Key,Value>>(head);
         }
+        /*
+        默认析构从head开始沿next逐个释放shared_ptr，每个节点的析构里再释放下一个，递归深度等于链表长度
+        几十万个节点落在同一条链表上时会栈溢出，这里改成循环：每次先把next移出来，再释放当前节点
+        */
+        ~FreqList()
+        {
+            auto node=std::move(head);
+            while (node!=nullptr)
+            {
+                node=std::move(node->next);
+            }
+        }
+        FreqList(const FreqList&)=delete;
+        FreqList& operator=(const FreqList&)=delete;
+        // 空链表复用给另一个频率
+        void reset(const Frequency freq)
+        {
+            ListFrequency=freq;
+        }
 
         bool isEmpty()
         {
@@ -60,6 +105,7 @@ namespace LFU
                 tailPrevPtr->next=node;
             }
             tail->prev=node;
+            NodeCount++;
         }
         void removeNodeFromCurrList(std::shared_ptr<Node<Key,Value> > node)
         {
@@ -73,6 +119,30 @@ namespace LFU
 
             node->next=nullptr;
             node->prev.reset();
+            NodeCount--;
+        }
+        // 把另一条链表的全部节点整体接到本链表尾部，只改首尾几个指针，与节点数无关
+        void spliceToCurrTail(FreqList& other)
+        {
+            if (other.isEmpty())
+            {
+                return;
+            }
+            auto first=other.head->next;
+            auto last=other.tail->prev.lock();
+            auto currLast=tail->prev.lock();
+            currLast->next=first;
+            first->prev=currLast;
+            last->next=tail;
+            tail->prev=last;
+            other.head->next=other.tail;
+            other.tail->prev=other.head;
+            NodeCount+=other.NodeCount;
+            other.NodeCount=0;
+        }
+        int size() const
+        {
+            return NodeCount;
         }
         std::shared_ptr<Node<Key,Value>> getCurrFirstNode()
         {
@@ -84,154 +154,572 @@ namespace LFU
         }
     };
 
-    template <typename Key,typename Value>
+    /*
+    LFU节点池用的内存资源：按16字节分档，每档一条空闲链表
+    deallocate只是把块挂回对应的链表，O(1)，不像pool_resource那样要先查块属于哪个chunk；
+    块从monotonic_buffer_resource按大块切出来，缓存析构时整块归还，几百万个节点析构时不会在逐个释放上花时间
+    超过MAX_BLOCK或对齐要求更高的分配很少见，直接交给upstream（value直接存在节点里时，value本身超过几百字节的节点也走这条路）
+    不加锁：所有分配都在LFUAlgorithm的mutex内进行
+    */
+    class NodeArena final : public std::pmr::memory_resource
+    {
+        static constexpr std::size_t GRANULE=16;
+        static constexpr std::size_t MAX_BLOCK=512;
+
+        struct FreeBlock
+        {
+            FreeBlock* next;
+        };
+
+        std::pmr::monotonic_buffer_resource blocks;
+        std::pmr::memory_resource* upstream;
+        std::array<FreeBlock*,MAX_BLOCK/GRANULE> freeLists{};
+
+        static bool pooled(const std::size_t bytes,const std::size_t alignment)
+        {
+            return bytes<=MAX_BLOCK && alignment<=GRANULE;
+        }
+        static std::size_t classOf(const std::size_t bytes)
+        {
+            return (std::max<std::size_t>(bytes,1)+GRANULE-1)/GRANULE-1;
+        }
+
+        void* do_allocate(const std::size_t bytes,const std::size_t alignment) override
+        {
+            if (!pooled(bytes,alignment))
+            {
+                return upstream->allocate(bytes,alignment);
+            }
+            const std::size_t cls=classOf(bytes);
+            if (FreeBlock* block=freeLists[cls])
+            {
+                freeLists[cls]=block->next;
+                return block;
+            }
+            return blocks.allocate((cls+1)*GRANULE,GRANULE);
+        }
+        void do_deallocate(void* p,const std::size_t bytes,const std::size_t alignment) override
+        {
+            if (!pooled(bytes,alignment))
+            {
+                upstream->deallocate(p,bytes,alignment);
+                return;
+            }
+            const std::size_t cls=classOf(bytes);
+            freeLists[cls]=::new(p) FreeBlock{freeLists[cls]};
+        }
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+        {
+            return this==&other;
+        }
+
+    public:
+        explicit NodeArena(std::pmr::memory_resource* upstream):blocks(upstream),upstream(upstream){}
+        NodeArena(const NodeArena&)=delete;
+        NodeArena& operator=(const NodeArena&)=delete;
+    };
+
+    /*
+    value的保存方式和LRUAlgorithm一样由SharedValues选择，见AlgorithmStandard::ValueStorage
+    SharedValues=false：value直接存在节点里，和节点一起从NodeArena分配，插入新key只有一次分配，命中时少一次指针跳转；getHandle要拷贝一次value
+    SharedValues=true：节点里存value的shared_ptr，getHandle零拷贝；每次插入新key多一次make_shared
+    */
+    template <typename Key,typename Value,bool SharedValues=false>
     class LFUAlgorithm final :public AlgorithmStandard::Algorithmstandard<Key,Value>
     {
+        using ValueHandle=AlgorithmStandard::ValueHandle<Value>;
+        using StatsEvent=AlgorithmStandard::StatsEvent;
+        using Storage=AlgorithmStandard::ValueStorage<Value,SharedValues>;
+        using StoredValue=typename Storage::Stored;
+
+        /*
+        节点池：节点、链表哨兵和FreqToList的树节点都从这里分配，淘汰释放的内存留在池里给下一次插入复用，不回到全局堆
+        池本身向upstream按块申请内存，见NodeArena
+        value默认直接存在节点里，跟着节点一起放在池里；SharedValues=true时value在全局堆上，因为getHandle交出去的句柄可能比缓存活得更久
+        必须是第一个成员，最后一个析构，保证所有节点都先于它释放
+        */
+        NodeArena NodeResource;
         // 索引出现次数对应的双向链表,注意这里的第二个参数是指针，指向一个新的Freqlist模板类实例，指针可以提升效率
-        std::unordered_map<int,std::unique_ptr<FreqList<Key,Value>>> FreqToList;
+        // 按频率有序：第一条链表就是最小频率，老化时要合并的低频链表也都在开头，不需要遍历或排序
+        using FreqMap=std::pmr::map<Frequency,std::unique_ptr<FreqList<Key,StoredValue>>>;
+        FreqMap FreqToList;
+        std::vector<std::unique_ptr<FreqList<Key,StoredValue>>> SpareLists;
+        // 删空的频率链表（连同两个哨兵）留着给下一个新出现的频率复用
         // 改为使用unique指针，因为一个链表只会被一个map持有
         // 用来查找某个key是否存在以及对应的node在哪的主索引.
-        // LFU 算法的核心是按访问频率 (Frequency) 分组。这个 map 的键必须是 int，代表访问频率。
-        std::unordered_map<Key,std::shared_ptr<Node<Key,Value>>> cache;
-        int minFrequency;
-        std::mutex mutex;
+        // LFU 算法的核心是按访问频率 (Frequency) 分组。这个 map 的键是 Frequency（64位整数），代表访问频率。
+        // 开放寻址的扁平哈希表，节点指针直接存在表里
+        using Index=AlgorithmStandard::FlatIndex<Key,std::shared_ptr<Node<Key,StoredValue>>>;
+        Index cache;
+        Frequency minFrequency;
+        std::size_t capacity;
+        // 设置了权重函数时capacity是权重总和的上限，否则就是条目个数的上限
+        AlgorithmStandard::Weigher<Key,Value> weigher;
+        std::size_t totalWeight;
+        AlgorithmStandard::TimedMutex<std::mutex> mutex{this->statistics};
 
         int threshold;
-        int currentAverageNumber;
-        int currentTotalNumber;
+        Frequency currentAverageNumber;
+        Frequency currentTotalNumber;
         // 当平均值大于最大平均值限制时将所有结点的访问次数减去最大平均值限制的一半或者一个固定值。
         // 相当于热点数据“老化”了，这样可以避免频次计数溢出，也可以缓解缓存污染。
 
+        std::vector<std::shared_ptr<Node<Key,StoredValue>>*> BatchNodes;
+        // getMany第一遍查到的节点（指向cache里保存的shared_ptr，批量读过程中没有插入，索引不会扩容，地址不变），复用内存
+        Frequency FrequencyOffset;
+        TTL::TimerWheel<Key> wheel; // 带TTL的条目的过期安排，没有用过TTL时它一直是空的
+        // 老化偏移量：节点和FreqToList里存的都是“原始频率”，实际频率=原始频率-FrequencyOffset
+        // 老化时只增加偏移量，所有节点的实际频率就一起降低了，不需要逐个修改节点
+        // 实际频率被减到1以下的那些链表整体拼接成一条，节点里过期的原始频率等下次被访问时再修正
+
         private:
 
-        void AddNodeToNewFrequencyList(std::shared_ptr<Node<Key,Value>> node)
+        void AddNodeToNewFrequencyList(std::shared_ptr<Node<Key,StoredValue>> node)
         {
-            int freq = node->NodeFrequency;
-            if (FreqToList.contains(freq) == false || FreqToList[freq] == nullptr)
+            const Frequency freq = node->NodeFrequency;
+            // 先拿到链表再插入map：AcquireList抛出异常时map里不会留下空指针
+            auto iter = FreqToList.lower_bound(freq);
+            if (iter == FreqToList.end() || iter->first != freq)
             {
-                FreqToList[freq] = std::make_unique<FreqList<Key,Value>>(freq);
+                iter = FreqToList.emplace_hint(iter, freq, AcquireList(freq));
             }
-            FreqToList[freq]->addNodeToCurrTail(node);
+            iter->second->addNodeToCurrTail(node);
         }
-        void DeleteOldNode()
+        std::unique_ptr<FreqList<Key,StoredValue>> AcquireList(const Frequency freq)
         {
-            // 要考虑不存在的情况
-            if (FreqToList.contains(minFrequency)==false)
+            if (SpareLists.empty())
             {
-                UpdateMinfrequency();
-                if (FreqToList.contains(minFrequency)==false) return;
-                // 那就是全空直接删完了
+                return std::make_unique<FreqList<Key,StoredValue>>(freq,&NodeResource);
             }
-            auto list = FreqToList[minFrequency].get();
-            // 这里要注意改了uniqueptr之后，不能直接取出对应的频率指针赋值给list
-            // 要使用uniqueptr标准库中的 get()方法获取指针
-            if (list==nullptr || list->isEmpty()) return;
+            auto list = std::move(SpareLists.back());
+            SpareLists.pop_back();
+            list->reset(freq);
+            return list;
+        }
+        // 代替FreqToList.erase：链表必须已经是空的；返回下一条链表
+        typename FreqMap::iterator ReleaseList(const typename FreqMap::iterator iter)
+        {
+            SpareLists.push_back(std::move(iter->second));
+            return FreqToList.erase(iter);
+        }
+        void DeleteOldNode()
+        {
+            CACHE_LATENCY_SCOPE(EVICTION);
+            // 要考虑不存在的情况，那就是全空直接删完了
+            if (FreqToList.empty()) return;
+            // FreqToList有序，第一条链表就是最小频率的链表，删空的链表都会及时释放
+            auto list = FreqToList.begin()->second.get();
             auto NodeToDelete = list->getCurrFirstNode();
             if (NodeToDelete==nullptr)
             {
-                // 因此list无须手动删除，uniqueptr销毁的时候会一并销毁list
-                FreqToList.erase(minFrequency);
+                ReleaseList(FreqToList.begin());
                 UpdateMinfrequency();
                 return;
             }
-            list->removeNodeFromCurrList(NodeToDelete);
-            cache.erase(NodeToDelete->key);
-            currentTotalNumber -= NodeToDelete->NodeFrequency;
+            RemoveNode(NodeToDelete);
+            this->statistics.record(StatsEvent::EVICTION);
+        }
+        // 把指定节点从频率链表和cache里删掉，淘汰和TTL过期共用
+        // 参数按值传递：cache.erase会销毁map里的那份shared_ptr，这里要自己持有一份
+        void RemoveNode(const std::shared_ptr<Node<Key,StoredValue>> node)
+        {
+            ClearTimer(*node);
+            NormalizeFrequency(node);
+            const Frequency freq = node->NodeFrequency;
+            auto ListIter = FreqToList.find(freq);
+            if (ListIter != FreqToList.end())
+            {
+                ListIter->second->removeNodeFromCurrList(node);
+                if (ListIter->second->isEmpty())
+                {
+                    // 最小频率链表被删空时要及时更新，否则连续淘汰（resize缩容）会卡在空链表上
+                    ReleaseList(ListIter);
+                    if (freq == minFrequency) UpdateMinfrequency();
+                }
+            }
+            totalWeight -= node->Weight;
+            cache.erase(node->key);
+            currentTotalNumber -= freq - FrequencyOffset;
             if (cache.size() == 0)
                 currentAverageNumber = 0;
             else
-                currentAverageNumber = currentTotalNumber / cache.size();
+                currentAverageNumber = currentTotalNumber / static_cast<Frequency>(cache.size());
+        }
+        // 取消节点的TTL，时间轮里对应的条目一起删掉
+        void ClearTimer(Node<Key,StoredValue>& node)
+        {
+            if (node.Timer != TTL::NO_TIMER)
+            {
+                wheel.cancel(node.Timer);
+                node.Timer = TTL::NO_TIMER;
+            }
+            node.ExpireTick = 0;
+        }
+        /*
+        每次操作开头推进时间轮，回收已经到期的条目，返回当前tick
+        没有任何带TTL的条目时直接返回0，连时钟都不读
+        节点被覆盖或删除时已经取消了自己的条目，触发的条目一定对应一个还在缓存里的节点
+        */
+        std::uint64_t ExpireEntries()
+        {
+            if (wheel.empty())
+            {
+                return 0;
+            }
+            const std::uint64_t now = wheel.now();
+            wheel.advance(now, [this](const Key& key, const TTL::TimerHandle handle)
+            {
+                auto CacheIter = cache.find(key);
+                if (CacheIter != cache.end() && CacheIter->second->Timer == handle)
+                {
+                    // 条目已经被时间轮回收，RemoveNode不能再取消它
+                    CacheIter->second->Timer = TTL::NO_TIMER;
+                    RemoveNode(CacheIter->second);
+                    this->statistics.record(StatsEvent::EXPIRATION);
+                }
+            });
+            return now;
+        }
+        // 时间轮一次推进的步数有上限，长时间空闲后可能还没轮到回收，所以命中时再核对一次
+        static bool IsExpired(const Node<Key,StoredValue>& node, const std::uint64_t now)
+        {
+            return node.ExpireTick != 0 && node.ExpireTick <= now;
+        }
+        // 原始频率不高于偏移量的节点，所在链表已经在老化时并入了 FrequencyOffset+1 那条链表
+        void NormalizeFrequency(const std::shared_ptr<Node<Key,StoredValue>>& node)
+        {
+            if (node->NodeFrequency <= FrequencyOffset)
+            {
+                node->NodeFrequency = FrequencyOffset + 1;
+            }
         }
-        void NodeFreqUpgrade(std::shared_ptr<Node<Key,Value>> node)
+        /*
+        get/put命中：频率+1，旧频率链表空了就删除，必要时更新最小频率
+        新频率的链表如果存在，就是FreqToList里紧跟在旧链表后面的那一条，不存在时用emplace_hint插在那个位置，不需要再查找
+        旧链表要在addFrequencyCount之前释放：它可能触发老化，老化会合并、删除开头的链表
+        */
+        void TouchNode(const std::shared_ptr<Node<Key,StoredValue>>& Nodeptr)
         {
-            int OldFrequency = node->NodeFrequency;
-            if (FreqToList.contains(OldFrequency))
+            NormalizeFrequency(Nodeptr);
+            // 你必须先保存旧频率，然后执行升级，最后再检查旧频率对应的列表是否为空。
+            const Frequency OldFrequency=Nodeptr->NodeFrequency;
+            const Frequency NewFrequency=OldFrequency+1;
+            auto OldIter=FreqToList.find(OldFrequency);
+            Nodeptr->NodeFrequency=NewFrequency;
+            if (OldIter==FreqToList.end())
             {
-                auto oldList = FreqToList[OldFrequency].get();
-                if (oldList!=nullptr)
+                AddNodeToNewFrequencyList(Nodeptr);
+                addFrequencyCount();
+                return;
+            }
+            OldIter->second->removeNodeFromCurrList(Nodeptr);
+            auto NewIter=std::next(OldIter);
+            if (NewIter==FreqToList.end() || NewIter->first!=NewFrequency)
+            {
+                NewIter=FreqToList.emplace_hint(NewIter,NewFrequency,AcquireList(NewFrequency));
+            }
+            NewIter->second->addNodeToCurrTail(Nodeptr);
+            if (OldIter->second->isEmpty())
+            {
+                ReleaseList(OldIter);
+                if (OldFrequency == minFrequency)
                 {
-                   oldList->removeNodeFromCurrList(node);
+                    UpdateMinfrequency();
                 }
             }
-            node->NodeFrequency+=1;
-            AddNodeToNewFrequencyList(node);
             addFrequencyCount();
         }
-        void NewNodeInsert(Key key,Value value)
+        // 按最小频率逐个淘汰，直到再放入weight也不超过容量；没有可淘汰的节点时停下
+        void EvictUntilFits(const std::size_t weight)
         {
-            if (cache.size() >= DEFAULT_CACHE_CAPACITY)
+            while (totalWeight + weight > capacity)
             {
+                const std::size_t SizeBefore=cache.size();
                 DeleteOldNode();
+                if (cache.size()==SizeBefore) break;
+            }
+        }
+        // 调用前新key已经用try_emplace在cache里占好了位置（值为nullptr），所以这里不用再查一次哈希表
+        // 单个条目的权重就超过容量（包括容量为0）时不插入，返回false，由调用方的PlaceholderGuard撤销占位
+        bool NewNodeInsert(typename Index::iterator CacheIter,StoredValue value)
+        {
+            const std::uint32_t weight=AlgorithmStandard::weigh(weigher,CacheIter->first,Storage::get(value));
+            if (weight > capacity)
+            {
+                return false;
             }
-            auto NewNode=std::make_shared<Node<Key,Value>>(key,value);
-            minFrequency = 1;
+            EvictUntilFits(weight);
+            // 淘汰的是链表里的其他key，FlatIndex的erase不会移动其他元素，CacheIter仍然有效
+            auto NewNode=std::allocate_shared<Node<Key,StoredValue>>(std::pmr::polymorphic_allocator<Node<Key,StoredValue>>(&NodeResource),CacheIter->first,std::move(value));
+            NewNode->Weight = weight;
+            NewNode->NodeFrequency = FrequencyOffset + 1;
+            // 可能抛出异常的分配都在修改计数之前完成
             AddNodeToNewFrequencyList(NewNode);
-            cache[key]=NewNode;
+            totalWeight += weight;
+            minFrequency = FrequencyOffset + 1;
+            CacheIter->second=std::move(NewNode);
             addFrequencyCount();
+            return true;
+        }
+
+        // 只查一次哈希表：try_emplace找到就更新，找不到就直接在占好的位置上插入
+        template<typename V,typename K>
+        void putValue(V&& val,K&& key)
+        {
+            CACHE_LATENCY_SCOPE(PUT);
+            std::lock_guard lock(mutex);
+            ExpireEntries();
+            putUnlocked(std::forward<V>(val),std::forward<K>(key));
+        }
+        // 带TTL的写入：先照常写入，再把过期时刻记到节点上并交给时间轮
+        template<typename V>
+        void putWithTTL(V&& val,const Key& key,const std::chrono::milliseconds ttl)
+        {
+            CACHE_LATENCY_SCOPE(PUT);
+            std::lock_guard lock(mutex);
+            ExpireEntries();
+            Node<Key,StoredValue>* node=putUnlocked(std::forward<V>(val),key);
+            if (node==nullptr)
+            {
+                return;
+            }
+            // 覆盖旧key时putUnlocked已经取消了原来的条目，时间轮里每个key最多只有一个条目
+            node->ExpireTick=wheel.deadlineAfter(ttl);
+            node->Timer=wheel.schedule(node->key,node->ExpireTick);
+        }
+        // 调用者负责加锁；返回写入的节点，容量为0没有写入时返回nullptr
+        // 不带TTL的写入会清掉节点原来的TTL；key是右值时只有插入新key才会移动它
+        template<typename V,typename K>
+        Node<Key,StoredValue>* putUnlocked(V&& val,K&& key)
+        {
+            auto [CacheIter,inserted]=cache.try_emplace(std::forward<K>(key),nullptr);
+            this->recordPut(!inserted);
+            if (!inserted)
+            {
+                Storage::assign(CacheIter->second->value,std::forward<V>(val));
+                ClearTimer(*CacheIter->second);
+                TouchNode(CacheIter->second);
+                if (weigher)
+                {
+                    return Reweigh(CacheIter->second);
+                }
+                return CacheIter->second.get();
+            }
+            AlgorithmStandard::PlaceholderGuard placeholder(cache,CacheIter);
+            if (!NewNodeInsert(CacheIter,Storage::make(std::forward<V>(val))))
+            {
+                return nullptr;
+            }
+            placeholder.release();
+            return CacheIter->second.get();
+        }
+
+        /*
+        覆盖后value的权重可能变大，按LFU顺序淘汰直到放得下
+        这个节点刚升过频率，只有比它频率低或同频率更早的节点都淘汰完仍然放不下时才会轮到它自己
+        参数按值传递，节点自己被淘汰时仍然有效；被淘汰（不在任何链表里）时返回nullptr
+        */
+        Node<Key,StoredValue>* Reweigh(const std::shared_ptr<Node<Key,StoredValue>> node)
+        {
+            const std::uint32_t weight=AlgorithmStandard::weigh(weigher,node->key,Storage::get(node->value));
+            totalWeight = totalWeight - node->Weight + weight;
+            node->Weight = weight;
+            if (weight > capacity)
+            {
+                RemoveNode(node);
+                this->statistics.record(StatsEvent::EVICTION);
+                return nullptr;
+            }
+            EvictUntilFits(0);
+            return node->next==nullptr?nullptr:node.get();
         }
 
         public:
-        explicit LFUAlgorithm(const int threshold):
-            minFrequency(INT_MAX),
-            threshold(threshold),currentAverageNumber(0),currentTotalNumber(0)
+        /*
+        weigher为空时按条目个数限制容量
+        设置了weigher时capacity是权重总和的上限（例如字节数），条目个数事先不知道，哈希表不预留
+        upstream是节点池向外申请大块内存的来源，默认是全局堆，可以换成自定义的memory_resource
+        */
+        explicit LFUAlgorithm(const int threshold,const std::size_t capacity=DEFAULT_CACHE_CAPACITY,AlgorithmStandard::Weigher<Key,Value> weigher={},
+                              std::pmr::memory_resource* upstream=std::pmr::get_default_resource()):
+            NodeResource(upstream),FreqToList(&NodeResource),minFrequency(1),capacity(capacity),weigher(std::move(weigher)),totalWeight(0),
+            threshold(threshold),currentAverageNumber(0),currentTotalNumber(0),FrequencyOffset(0)
         {
+            if (!this->weigher)
+            {
+                cache.reserve(capacity+1);
+                // 多留一个给插入时的占位；FlatIndex删除时不留墓碑，之后put、淘汰反复多少次都不会rehash
+            }
         }
         ~LFUAlgorithm() override = default;
+
+        // 运行时调整容量：缩小时按LFU顺序（最小频率链表的头部）逐个淘汰，扩大时一次性reserve哈希表
+        // 设置了权重函数时newCapacity是新的权重上限，扩大时不预留
+        void resize(const std::size_t newCapacity)
+        {
+            std::lock_guard lock(mutex);
+            capacity=newCapacity;
+            if (totalWeight<=capacity)
+            {
+                if (!weigher) cache.reserve(capacity+1);
+                return;
+            }
+            EvictUntilFits(0);
+        }
+
+        std::size_t getCapacity()
+        {
+            std::lock_guard lock(mutex);
+            return capacity;
+        }
+
+        // 当前所有条目的权重总和，没有设置权重函数时就是条目个数
+        std::size_t getTotalWeight()
+        {
+            std::lock_guard lock(mutex);
+            return totalWeight;
+        }
+        // 时间轮里还在等待触发的条目数，不会超过带TTL的节点数
+        std::size_t getPendingTimers()
+        {
+            std::lock_guard lock(mutex);
+            return wheel.size();
+        }
         // uniqueptr的析构函数会自动释放内存，所以不需要手动delete
         bool get(const Key& key, Value& value) override
         {
+            CACHE_LATENCY_SCOPE(GET);
             std::lock_guard lock(mutex);
+            const std::uint64_t now=ExpireEntries();
             // 迭代器可以直接使用->访问哈希表的键和值
-            if (cache.contains(key))
+            auto CacheIter=cache.find(key);
+            if (CacheIter!=cache.end())
             {
-                auto Nodeptr=cache.find(key)->second;
-                // 你必须先保存旧频率，然后执行升级，最后再检查旧频率对应的列表是否为空。
-                int OldFrequency=Nodeptr->NodeFrequency;
-                NodeFreqUpgrade(Nodeptr);
-                if (FreqToList.contains(OldFrequency))
+                if (IsExpired(*CacheIter->second,now))
                 {
-                    auto oldList=FreqToList[OldFrequency].get(); //同前
-                    if (oldList!=nullptr && oldList->isEmpty())
-                    {
-                        FreqToList.erase(OldFrequency);
-                        if (OldFrequency == minFrequency)
-                        {
-                            UpdateMinfrequency();
-                        }
-                    }
+                    RemoveNode(CacheIter->second);
+                    this->statistics.record(StatsEvent::EXPIRATION);
+                    return this->recordLookup(false);
                 }
-                value=Nodeptr->value;
-                return true;
+                TouchNode(CacheIter->second);
+                value=Storage::get(CacheIter->second->value);
+                return this->recordLookup(true);
             }
-            return false;
+            return this->recordLookup(false);
         }
-        void put(const Value& val,const Key& key) override
+        // 一次加锁处理整批key：第一遍查哈希表并预取命中的节点，第二遍再升级频率、拷贝value
+        std::vector<bool> getMany(std::span<const Key> keys,std::span<Value> values) override
         {
+            const std::size_t count=std::min(keys.size(),values.size());
+            std::vector<bool> hits(count);
             std::lock_guard lock(mutex);
+            const std::uint64_t now=ExpireEntries();
+            BatchNodes.resize(count);
+            for (std::size_t i=0;i<count;i++)
+            {
+                auto CacheIter=cache.find(keys[i]);
+                BatchNodes[i]=CacheIter==cache.end()?nullptr:&CacheIter->second;
+                if (BatchNodes[i]!=nullptr)
+                {
+                    AlgorithmStandard::prefetch(BatchNodes[i]->get());
+                }
+            }
+            for (std::size_t i=0;i<count;i++)
+            {
+                if (BatchNodes[i]==nullptr) continue;
+                // 批量读的过程中不会插入或淘汰，第一遍拿到的地址仍然有效
+                const auto& Nodeptr=*BatchNodes[i];
+                // 过期的节点这里不删除，同一批里可能还有重复的key指向它，留给时间轮回收
+                if (IsExpired(*Nodeptr,now)) continue;
+                TouchNode(Nodeptr);
+                values[i]=Storage::get(Nodeptr->value);
+                hits[i]=true;
+            }
+            this->recordLookups(hits);
+            return hits;
+        }
+        void putMany(std::span<const Value> values,std::span<const Key> keys) override
+        {
+            const std::size_t count=std::min(keys.size(),values.size());
+            std::lock_guard lock(mutex);
+            ExpireEntries();
+            for (std::size_t i=0;i<count;i++)
+            {
+                putUnlocked(values[i],keys[i]);
+            }
+        }
+        ValueHandle getHandle(const Key& key) override
+        {
+            CACHE_LATENCY_SCOPE(GET);
+            std::lock_guard lock(mutex);
+            const std::uint64_t now=ExpireEntries();
             auto CacheIter=cache.find(key);
             if (CacheIter!=cache.end())
             {
-                CacheIter->second->value=val;
-                int OldFrequency=CacheIter->second->NodeFrequency;
-                NodeFreqUpgrade(CacheIter->second);
-                if (FreqToList.contains(OldFrequency))
+                auto Nodeptr=CacheIter->second;
+                if (IsExpired(*Nodeptr,now))
                 {
-                    auto oldList=FreqToList[OldFrequency].get();
-                    if (oldList!=nullptr && oldList->isEmpty())
-                    {
-                        FreqToList.erase(OldFrequency);
-
-                        if (OldFrequency == minFrequency)
-                        {
-                            UpdateMinfrequency();
-                        }
-                    }
+                    RemoveNode(Nodeptr);
+                    this->statistics.record(StatsEvent::EXPIRATION);
+                    this->recordLookup(false);
+                    return nullptr;
                 }
+                TouchNode(Nodeptr);
+                this->recordLookup(true);
+                return Storage::handle(Nodeptr->value);
             }
-            else
+            this->recordLookup(false);
+            return nullptr;
+        }
+        void put(const Value& val,const Key& key) override
+        {
+            putValue(val,key);
+        }
+        void put(Value&& val,const Key& key) override
+        {
+            putValue(std::move(val),key);
+        }
+        // key也是右值时：插入新key直接把key移动进索引，不拷贝
+        void put(Value&& val,Key&& key)
+        {
+            putValue(std::move(val),std::move(key));
+        }
+        // 带TTL的写入，ttl之后这个key按未命中处理并由时间轮回收；之后再用不带TTL的put覆盖会取消过期
+        void put(const Value& val,const Key& key,const std::chrono::milliseconds ttl)
+        {
+            putWithTTL(val,key,ttl);
+        }
+        void put(Value&& val,const Key& key,const std::chrono::milliseconds ttl)
+        {
+            putWithTTL(std::move(val),key,ttl);
+        }
+        // 只有key不存在时才用args构造value（SharedValues=true时直接构造在shared_ptr的控制块里，否则构造后移动进节点），key已存在时什么也不做，返回false
+        template<typename... Args>
+        bool tryEmplace(const Key& key,Args&&... args)
+        {
+            CACHE_LATENCY_SCOPE(PUT);
+            std::lock_guard lock(mutex);
+            const std::uint64_t now=ExpireEntries();
+            auto [CacheIter,inserted]=cache.try_emplace(key,nullptr);
+            if (!inserted)
             {
-                NewNodeInsert(key,val);
+                if (!IsExpired(*CacheIter->second,now))
+                {
+                    return false;
+                }
+                // 已过期但还没被回收的key视为不存在
+                RemoveNode(CacheIter->second);
+                this->statistics.record(StatsEvent::EXPIRATION);
+                CacheIter=cache.try_emplace(key,nullptr).first;
+            }
+            this->recordPut(false);
+            AlgorithmStandard::PlaceholderGuard placeholder(cache,CacheIter);
+            if (!NewNodeInsert(CacheIter,Storage::make(std::forward<Args>(args)...)))
+            {
+                return false;
             }
+            placeholder.release();
+            return true;
         }
         /*
         LFU-Aging 对于LFU的改进版
@@ -240,34 +728,37 @@ namespace LFU
         所以LFU-Aging加入了平均访问次数的概念
         如果节点的平均访问次数大于某个固定值x时，则将所有节点的count值减去x/2
         这样可解决“缓存污染”
+        这里的“减去x/2”是通过增大FrequencyOffset延迟完成的，见ReduceAllNodeFrequency
         */
         void UpdateMinfrequency()
         {
-            minFrequency=INT_MAX;
-            for (const auto& map_pair : FreqToList)
+            // FreqToList按频率有序，删空的链表都会及时释放，第一条就是最小频率
+            if (FreqToList.empty())
             {
-                if (map_pair.second != nullptr && map_pair.second->isEmpty()==false && map_pair.first < minFrequency)
-                {
-                    minFrequency=map_pair.first;
-                }
-            }
-
-            if (minFrequency == INT_MAX)
-            {
-                minFrequency = 1;
+                minFrequency = FrequencyOffset + 1;
+                return;
             }
+            minFrequency = FreqToList.begin()->first;
         }
         void addFrequencyCount()
         {
             currentTotalNumber++;
             if (cache.size()==0) currentAverageNumber=1;
-            else currentAverageNumber=currentTotalNumber/cache.size();
+            else currentAverageNumber=currentTotalNumber/static_cast<Frequency>(cache.size());
             if (currentAverageNumber>threshold) ReduceAllNodeFrequency();
         }
+        /*
+        老化不再遍历整个cache：
+        1. 偏移量增加ValueToReduce，实际频率仍大于1的链表原样保留（它们的实际频率自动减少了ValueToReduce）
+        2. 实际频率会降到1及以下的那些链表，按旧频率从低到高依次拼接成新的“实际频率为1”的链表
+        每条链表拼接是O(1)，所以一次老化的工作量只和被合并的链表条数有关，和缓存容量、频率的种类数都无关
+        被合并的链表就是FreqToList开头原始频率不超过MergedFrequency的那几条，最多ValueToReduce+1条（约为阈值的一半）
+        每条链表只会被创建一次、合并一次，均摊到每次访问上也是O(1)
+        */
         void ReduceAllNodeFrequency()
         {
-            int ValueToReduce = currentAverageNumber / 2;
-            int ReducedFrequency = 0;
+            Frequency ValueToReduce = currentAverageNumber / 2;
+            Frequency ReducedFrequency = 0;
 
             if (ValueToReduce == 0 && currentAverageNumber > 0)
             {
@@ -277,54 +768,40 @@ namespace LFU
             {
                 return;
             }
+            this->statistics.record(StatsEvent::AGING);
+            CACHE_LATENCY_SCOPE(AGING);
 
-            for (const auto& map_pair : cache)
+            const Frequency MergedFrequency = FrequencyOffset + ValueToReduce + 1;
+            // 需要合并的链表原始频率在 [FrequencyOffset+1, MergedFrequency] 之间，按频率从低到高依次拼接
+            auto MergedList = AcquireList(MergedFrequency);
+            auto ListIter = FreqToList.begin();
+            while (ListIter != FreqToList.end() && ListIter->first <= MergedFrequency)
             {
-                auto node = map_pair.second;
-                int NodeOldFrequency = node->NodeFrequency;
-
-                if (NodeOldFrequency == 1) continue;
-
-                if (FreqToList.contains(NodeOldFrequency))
-                {
-                    auto oldList = FreqToList[NodeOldFrequency].get();
-                    if (oldList != nullptr)
-                    {
-                        oldList->removeNodeFromCurrList(node);
-                    }
-                }
-
-                if (NodeOldFrequency - ValueToReduce < 1)
-                {
-                    ReducedFrequency +=  NodeOldFrequency - 1;
-                    node->NodeFrequency = 1;
-                }
-                else
-                {
-                    ReducedFrequency += ValueToReduce;
-                    node->NodeFrequency -= ValueToReduce;
-                }
-
-                AddNodeToNewFrequencyList(node);
+                // 这条链表上每个节点减少 实际频率-1
+                ReducedFrequency += static_cast<Frequency>(ListIter->second->size()) * (ListIter->first - FrequencyOffset - 1);
+                MergedList->spliceToCurrTail(*ListIter->second);
+                ListIter = ReleaseList(ListIter);
             }
-
-            for (auto it = FreqToList.begin(); it != FreqToList.end();)
+            const int MergedCount = MergedList->size();
+            ReducedFrequency += ValueToReduce * (static_cast<Frequency>(cache.size()) - MergedCount);
+            FrequencyOffset += ValueToReduce;
+            if (MergedCount > 0)
             {
-                FreqList<Key, Value>* list = it->second.get();
-                if (list == nullptr || list->isEmpty())
-                {
-                    it = FreqToList.erase(it);
-                }
-                else
-                {
-                    ++it;
-                }
+                FreqToList.emplace_hint(FreqToList.begin(), MergedFrequency, std::move(MergedList));
+            }
+            else
+            {
+                SpareLists.push_back(std::move(MergedList));
             }
             UpdateMinfrequency();
             currentTotalNumber -= ReducedFrequency;
 
             if (cache.size() == 0) currentAverageNumber = 0;
-            else currentAverageNumber = currentTotalNumber / cache.size();
+            else currentAverageNumber = currentTotalNumber / static_cast<Frequency>(cache.size());
         }
     };
+
+    // 需要零拷贝getHandle时用：value放在shared_ptr里，句柄直接共享
+    template<typename Key,typename Value>
+    using SharedLFUAlgorithm=LFUAlgorithm<Key,Value,true>;
 }
\ No newline at end of file
@@ -1,146 +1,738 @@
-#pragma once
-
-#include <memory>
-#include <unordered_map>
-#include <mutex>
-#include "AlgorithmStandard.h"
-
-namespace LRU
-{
-    template<typename Key,typename Value>
-    class LRUAlgorithm;
-
-    template<typename Key,typename Value>
-    class LRUNode
-    {
-        friend class LRUAlgorithm<Key,Value>;
-
-        Key key;
-        Value value;
-        std::shared_ptr<LRUNode> next;
-        std::weak_ptr<LRUNode> prev;
-
-        public:
-        LRUNode(Key key,Value val):key(key),value(val)
-        {
-            next=nullptr;
-            prev.reset();
-        }
-
-        Key getKey() const
-        {
-            return key;
-        }
-        Value getValue() const
-        {
-            return value;
-        }
-        // const 成员函数的用法（放在函数声明末尾），表示该函数的所有操作只读
-        void setValue(Value val)
-        {
-            value=val;
-        }
-        void setKey(Key key)
-        {
-            this->key=key;
-        }
-    };
-
-    template<typename Key,typename Value>
-    class LRUAlgorithm final : public AlgorithmStandard::Algorithmstandard<Key,Value>
-    {
-        std::unordered_map<Key,std::shared_ptr<LRUNode<Key,Value> > > cache;
-        // 对于unordered_map的operator[key]，如果找到会返回value（返回某变量的引用=返回某变量本身）。
-        std::shared_ptr<LRUNode<Key,Value>> dummyhead;
-        std::shared_ptr<LRUNode<Key,Value>> dummytail;
-        std::mutex mutex;
-
-        void addNodeToLast(std::shared_ptr<LRUNode<Key,Value> > node)
-        {
-            if (auto dummytail_prev_shareptr=dummytail->prev.lock())
-            {
-                dummytail_prev_shareptr->next=node;
-            }
-            node->prev=dummytail->prev;
-            node->next=dummytail;
-            dummytail->prev=node;
-        }
-
-        void removeNode(std::shared_ptr<LRUNode<Key,Value> > node)
-        {
-            node->next->prev=node->prev;
-            if (auto node_prev_sharedptr=node->prev.lock())
-                node_prev_sharedptr->next=node->next;
-            node->next=nullptr;
-            node->prev.reset();
-        }
-
-    public:
-        ~LRUAlgorithm() override=default;
-
-        explicit LRUAlgorithm()
-        {
-            dummyhead=std::make_shared<LRUNode<Key,Value> >(Key{}, Value{});
-            dummytail=std::make_shared<LRUNode<Key,Value> >(Key{}, Value{});
-            // 这是一个函数，调用它并希望返回变量需要加括号 
-            // make_shared<节点类型>(传给节点构造函数的参数)
-            // 同时需要给出默认的value和key（LRUNode模版要求）
-
-            // 使用makeshare而非new来构造sharedpointer更加合适
-            dummyhead->next=dummytail;
-            dummytail->prev=dummyhead;
-            // 这里一定要记得先为dummytail和dummyhead分配内存，直接就后两行就是空指针
-        }
-        // 注意每次调用都会更新上次访问历史记录
-
-        bool get(const Key& key, Value& value) override
-        {
-            std::lock_guard lock(mutex);
-            auto iter=cache.find(key);
-            if (iter!=cache.end())
-            {
-                auto node_ptr=cache[key];
-                value=node_ptr->getValue();
-                removeNode(node_ptr);
-                addNodeToLast(node_ptr);
-                return true;
-            }
-            return false;
-        }
-
-        void put(const Value& val,const Key& key) override
-        {
-            std::lock_guard lock(mutex);
-            auto iter=cache.find(key);
-            if (iter!=cache.end())
-            {
-                // 记得更新value值（刚被访问）
-                auto node=cache[key];
-                node->setValue(val);
-                removeNode(cache[key]);
-                addNodeToLast(cache[key]);
-            }
-            else
-            {
-                if (DEFAULT_CACHE_CAPACITY<=cache.size())
-                {
-                    auto NodeToDelete=dummyhead->next;
-                    cache.erase(NodeToDelete->getKey());
-                    removeNode(NodeToDelete);
-                    auto newNode=std::make_shared<LRUNode<Key,Value> >(key,val);
-                    // 不要使用new关键字，使用make_shared确保创建在堆上（手动，否则会被直接释放）
-                    cache[key]=newNode;
-                    // 不需要使用insert，因为cache[key]无法找到时会自动创建一个新的键值对（0和nullptr）
-                    // 找到时会返回std::shared_ptr的引用
-                    addNodeToLast(newNode);
-                }
-                else
-                {
-                    auto NewNode=std::make_shared<LRUNode<Key,Value> >(key,val);
-                    cache[key]=NewNode;
-                    addNodeToLast(NewNode);
-                }
-            }
-        }
-    };
-}
\ No newline at end of file
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <mutex>
+#include <ranges>
+#include <shared_mutex>
+#include <span>
+#include <type_traits>
+#include "AlgorithmStandard.h"
+#include "FlatIndex.h"
+#include "TimerWheel.h"
+
+namespace LRU
+{
+    // 空下标，相当于原来链表里的nullptr
+    inline constexpr std::uint32_t NIL_INDEX=UINT32_MAX;
+
+    template<typename Key,typename Value>
+    struct LRUNode
+    {
+        Key key;
+        Value value;
+        // 用32位下标代替shared_ptr/weak_ptr，链表操作只是普通的整数赋值，没有原子引用计数
+        std::uint32_t prev;
+        std::uint32_t next;
+        std::uint32_t list; // 节点当前所在链表（哨兵下标），多链表的算法靠它区分节点属于哪一段
+        std::uint32_t weight; // 节点占用的容量，没有设置权重函数时为1
+        std::uint8_t accessed; // 访问位（延迟提升的LRU、SIEVE用），命中时只置位，淘汰时再决定去留
+        TTL::TimerHandle timer; // 时间轮里的条目，覆盖或删除节点时用它取消；NO_TIMER表示没有
+        std::uint64_t expireTick; // TTL过期时刻（TimerWheel的tick），0表示不过期
+
+        LRUNode(Key key,Value val):key(std::move(key)),value(std::move(val)),prev(NIL_INDEX),next(NIL_INDEX),list(NIL_INDEX),weight(1),accessed(0),
+            timer(TTL::NO_TIMER),expireTick(0){}
+
+        Key getKey() const
+        {
+            return key;
+        }
+        Value getValue() const
+        {
+            return value;
+        }
+        // const 成员函数的用法（放在函数声明末尾），表示该函数的所有操作只读
+        void setValue(Value val)
+        {
+            value=std::move(val);
+        }
+        void setKey(Key key)
+        {
+            this->key=std::move(key);
+        }
+    };
+
+    /*
+    节点池：所有节点放在一段连续的vector里，用下标互相连接
+    前 listCount 个位置是各条链表的哨兵（dummyhead和dummytail合并为一个环形哨兵）
+    被删除的节点不会释放，而是通过next串成空闲链表，下次插入时直接复用
+    构造时按容量reserve，之后vector不会再扩容，所以命中和替换都不会有节点的堆分配
+    （LRUAlgorithm的SharedValues=true时value本身另外放在shared_ptr里，每次插入新key仍有一次make_shared）
+    */
+    template<typename Key,typename Value>
+    class LRUNodePool
+    {
+        std::vector<LRUNode<Key,Value>> nodes;
+        std::uint32_t freeHead;
+        std::uint32_t listCount;
+
+    public:
+        explicit LRUNodePool(const std::size_t capacity,const std::uint32_t listCount=1):
+            freeHead(NIL_INDEX),listCount(listCount)
+        {
+            nodes.reserve(capacity+listCount);
+            for (std::uint32_t i=0;i<listCount;i++)
+            {
+                nodes.emplace_back(Key{},Value{});
+                nodes[i].prev=i;
+                nodes[i].next=i;
+                // 空链表的哨兵前后都指向自己
+            }
+        }
+
+        // 只扩大不缩小，已有节点的下标保持不变
+        void reserve(const std::size_t capacity)
+        {
+            nodes.reserve(capacity+listCount);
+        }
+
+        LRUNode<Key,Value>& operator[](const std::uint32_t index)
+        {
+            return nodes[index];
+        }
+        const LRUNode<Key,Value>& operator[](const std::uint32_t index) const
+        {
+            return nodes[index];
+        }
+
+        std::uint32_t allocate(Key key,Value val)
+        {
+            if (freeHead!=NIL_INDEX)
+            {
+                const std::uint32_t index=freeHead;
+                freeHead=nodes[index].next;
+                nodes[index].key=std::move(key);
+                nodes[index].value=std::move(val);
+                nodes[index].prev=NIL_INDEX;
+                nodes[index].next=NIL_INDEX;
+                nodes[index].weight=1;
+                nodes[index].accessed=0;
+                nodes[index].timer=TTL::NO_TIMER;
+                nodes[index].expireTick=0;
+                return index;
+            }
+            nodes.emplace_back(std::move(key),std::move(val));
+            return static_cast<std::uint32_t>(nodes.size()-1);
+        }
+
+        // 调用前节点必须已经从链表中摘下
+        void release(const std::uint32_t index)
+        {
+            nodes[index].prev=NIL_INDEX;
+            nodes[index].next=freeHead;
+            freeHead=index;
+        }
+
+        void addNodeToLast(const std::uint32_t list,const std::uint32_t index)
+        {
+            const std::uint32_t last=nodes[list].prev;
+            nodes[index].prev=last;
+            nodes[index].next=list;
+            nodes[index].list=list;
+            nodes[last].next=index;
+            nodes[list].prev=index;
+        }
+
+        void removeNode(const std::uint32_t index)
+        {
+            LRUNode<Key,Value>& node=nodes[index];
+            nodes[node.prev].next=node.next;
+            nodes[node.next].prev=node.prev;
+            node.prev=NIL_INDEX;
+            node.next=NIL_INDEX;
+            node.list=NIL_INDEX;
+        }
+
+        // 摘下后接到目标链表尾部，目标可以是原来的链表（相当于刷新访问时间）
+        void moveNodeToLast(const std::uint32_t list,const std::uint32_t index)
+        {
+            removeNode(index);
+            addNodeToLast(list,index);
+        }
+
+        // 链表为空时返回哨兵自身的下标
+        std::uint32_t first(const std::uint32_t list) const
+        {
+            return nodes[list].next;
+        }
+        bool isEmpty(const std::uint32_t list) const
+        {
+            return nodes[list].next==list;
+        }
+    };
+
+    /*
+    LazyPromotion=false：经典LRU，每次命中都把节点移到链表尾部，所以读也要拿独占锁
+    LazyPromotion=true：命中只给节点置一个访问位，不改链表（CLOCK的second chance）
+        淘汰时从链表头部看起，访问位为1的节点清掉访问位移到尾部，直到遇到访问位为0的节点才淘汰
+        读路径不修改任何共享结构，用shared_mutex的共享锁，多个读线程可以同时命中
+        淘汰顺序是LRU的近似：两次淘汰之间多次命中和一次命中没有区别
+    SharedValues=false：value直接存在节点里，稳定运行后插入、命中、淘汰都没有堆分配，getHandle要拷贝一次value
+    SharedValues=true：节点里存value的shared_ptr，getHandle零拷贝；每次插入新key多一次make_shared，每次读多一次指针跳转
+    */
+    template<typename Key,typename Value,bool LazyPromotion=false,bool SharedValues=false>
+    class LRUAlgorithm final : public AlgorithmStandard::Algorithmstandard<Key,Value>
+    {
+        static constexpr std::uint32_t LRU_LIST=0;
+        using ValueHandle=AlgorithmStandard::ValueHandle<Value>;
+        using StatsEvent=AlgorithmStandard::StatsEvent;
+        using Storage=AlgorithmStandard::ValueStorage<Value,SharedValues>;
+        using StoredValue=typename Storage::Stored;
+
+        using Index=AlgorithmStandard::FlatIndex<Key,std::uint32_t>;
+
+        Index cache;
+        // key到节点下标的索引，开放寻址的扁平哈希表，节点下标直接存在表里
+        LRUNodePool<Key,StoredValue> pool;
+        // 节点里保存的是value本身，或者SharedValues=true时value的shared_ptr（getHandle命中时直接把它交出去）
+        std::size_t capacity;
+        // 设置了权重函数时capacity是权重总和的上限，否则就是条目个数的上限
+        AlgorithmStandard::Weigher<Key,Value> weigher;
+        std::size_t totalWeight;
+        AlgorithmStandard::TimedMutex<std::conditional_t<LazyPromotion,std::shared_mutex,std::mutex>> mutex{this->statistics};
+        std::vector<std::uint32_t> batchIndices; // getMany第一遍查到的节点下标，复用内存避免每批都分配
+        TTL::TimerWheel<Key> wheel; // 带TTL的条目的过期安排，没有用过TTL时它一直是空的
+
+        // 新key已经用try_emplace占好了位置，这里负责淘汰并把节点挂上去
+        // 单个条目的权重就超过容量（包括容量为0）时不插入，返回false，由调用方的PlaceholderGuard撤销占位
+        bool insertNode(typename Index::iterator iter,StoredValue value)
+        {
+            const std::uint32_t weight=AlgorithmStandard::weigh(weigher,iter->first,Storage::get(value));
+            if (weight>capacity)
+            {
+                return false;
+            }
+            while (totalWeight+weight>capacity)
+            {
+                evictFirstNode();
+                // FlatIndex的erase不会移动其他元素，iter仍然有效
+            }
+            const std::uint32_t NewIndex=pool.allocate(iter->first,std::move(value));
+            // 淘汰后立刻复用刚释放的槽位，不会产生新的节点分配
+            iter->second=NewIndex;
+            pool[NewIndex].weight=weight;
+            totalWeight+=weight;
+            pool.addNodeToLast(LRU_LIST,NewIndex);
+            return true;
+        }
+
+        // 只查一次哈希表：try_emplace找到就更新，找不到就直接在占好的位置上插入
+        template<typename V,typename K>
+        void putValue(V&& val,K&& key)
+        {
+            CACHE_LATENCY_SCOPE(PUT);
+            std::lock_guard lock(mutex);
+            expireEntries();
+            putUnlocked(std::forward<V>(val),std::forward<K>(key));
+        }
+
+        // 带TTL的写入：先照常写入，再把过期时刻记到节点上并交给时间轮
+        template<typename V>
+        void putWithTTL(V&& val,const Key& key,const std::chrono::milliseconds ttl)
+        {
+            CACHE_LATENCY_SCOPE(PUT);
+            std::lock_guard lock(mutex);
+            expireEntries();
+            const std::uint32_t index=putUnlocked(std::forward<V>(val),key);
+            if (index==NIL_INDEX)
+            {
+                return;
+            }
+            const std::uint64_t deadline=wheel.deadlineAfter(ttl);
+            // 覆盖旧key时putUnlocked已经取消了原来的条目，时间轮里每个key最多只有一个条目
+            pool[index].expireTick=deadline;
+            pool[index].timer=wheel.schedule(pool[index].key,deadline);
+        }
+
+        // 调用者负责加锁；返回写入的节点下标，容量为0没有写入时返回NIL_INDEX
+        // 不带TTL的写入会清掉节点原来的TTL；key是右值时只有插入新key才会移动它
+        template<typename V,typename K>
+        std::uint32_t putUnlocked(V&& val,K&& key)
+        {
+            auto [iter,inserted]=cache.try_emplace(std::forward<K>(key),NIL_INDEX);
+            this->recordPut(!inserted);
+            if (!inserted)
+            {
+                // 记得更新value值（刚被访问）
+                const std::uint32_t index=iter->second;
+                Storage::assign(pool[index].value,std::forward<V>(val));
+                clearTimer(index);
+                promote(index);
+                if (weigher)
+                {
+                    return reweigh(index);
+                }
+                return index;
+            }
+            AlgorithmStandard::PlaceholderGuard placeholder(cache,iter);
+            if (!insertNode(iter,Storage::make(std::forward<V>(val))))
+            {
+                return NIL_INDEX;
+            }
+            placeholder.release();
+            return iter->second;
+        }
+
+        // 覆盖后value的权重可能变大：从链表头部淘汰其他节点直到放得下，它自己已经在尾部，不会先被淘汰
+        std::uint32_t reweigh(const std::uint32_t index)
+        {
+            const std::uint32_t weight=AlgorithmStandard::weigh(weigher,pool[index].key,Storage::get(pool[index].value));
+            totalWeight=totalWeight-pool[index].weight+weight;
+            pool[index].weight=weight;
+            if (weight>capacity)
+            {
+                removeEntry(index);
+                this->statistics.record(StatsEvent::EVICTION);
+                return NIL_INDEX;
+            }
+            while (totalWeight>capacity)
+            {
+                evictFirstNode();
+            }
+            return index;
+        }
+
+        // 取消节点的TTL，时间轮里对应的条目一起删掉
+        void clearTimer(const std::uint32_t index)
+        {
+            if (pool[index].timer!=TTL::NO_TIMER)
+            {
+                wheel.cancel(pool[index].timer);
+                pool[index].timer=TTL::NO_TIMER;
+            }
+            pool[index].expireTick=0;
+        }
+
+        void removeEntry(const std::uint32_t index)
+        {
+            clearTimer(index);
+            totalWeight-=pool[index].weight;
+            cache.erase(pool[index].key);
+            pool.removeNode(index);
+            pool.release(index);
+        }
+
+        // 共享锁下多个读线程会同时写访问位，所以访问位一律通过atomic_ref读写
+        bool testAndClearAccessed(const std::uint32_t index)
+        {
+            std::atomic_ref<std::uint8_t> accessed(pool[index].accessed);
+            if (accessed.load(std::memory_order_relaxed)==0)
+            {
+                return false;
+            }
+            accessed.store(0,std::memory_order_relaxed);
+            return true;
+        }
+
+        // 记录一次命中：延迟提升模式只置访问位（已经置过就不再写，避免多个核争同一条缓存行），否则直接移到尾部
+        void touch(const std::uint32_t index)
+        {
+            if constexpr (LazyPromotion)
+            {
+                std::atomic_ref<std::uint8_t> accessed(pool[index].accessed);
+                if (accessed.load(std::memory_order_relaxed)==0)
+                {
+                    accessed.store(1,std::memory_order_relaxed);
+                }
+            }
+            else
+            {
+                pool.moveNodeToLast(LRU_LIST,index);
+            }
+        }
+
+        /*
+        写入已有的key：移到尾部
+        延迟提升模式下同时置上访问位：reweigh接着淘汰时，头部被访问过的节点会被挪到它后面，
+        它没有访问位的话会排到这些节点前面，先于它们被淘汰
+        */
+        void promote(const std::uint32_t index)
+        {
+            pool.moveNodeToLast(LRU_LIST,index);
+            if constexpr (LazyPromotion)
+            {
+                touch(index);
+            }
+        }
+
+        void evictFirstNode()
+        {
+            CACHE_LATENCY_SCOPE(EVICTION);
+            // 链表头部（哨兵的next）就是最久未访问的节点
+            // 延迟提升模式下先给头部被访问过的节点第二次机会；每个节点最多被跳过一次，循环一定会结束
+            if constexpr (LazyPromotion)
+            {
+                while (testAndClearAccessed(pool.first(LRU_LIST)))
+                {
+                    pool.moveNodeToLast(LRU_LIST,pool.first(LRU_LIST));
+                }
+            }
+            removeEntry(pool.first(LRU_LIST));
+            this->statistics.record(StatsEvent::EVICTION);
+        }
+
+        /*
+        共享锁下的命中查找，只在延迟提升模式下使用
+        有带TTL的条目时命中可能需要删除过期节点，返回false让调用方退回独占锁的路径
+        时间轮为空说明没有节点带过期时刻，共享锁下不用检查过期
+        */
+        template<typename F>
+        bool sharedLookup(F&& onLookup)
+        {
+            std::shared_lock lock(mutex);
+            if (!wheel.empty())
+            {
+                return false;
+            }
+            onLookup();
+            return true;
+        }
+
+        /*
+        每次操作开头推进时间轮，回收已经到期的条目，返回当前tick
+        没有任何带TTL的条目时直接返回0，连时钟都不读，不用TTL的调用方没有额外开销
+        节点被覆盖或删除时已经取消了自己的条目，触发的条目一定对应一个还在缓存里的节点
+        */
+        std::uint64_t expireEntries()
+        {
+            if (wheel.empty())
+            {
+                return 0;
+            }
+            const std::uint64_t now=wheel.now();
+            wheel.advance(now,[this](const Key& key,const TTL::TimerHandle handle)
+            {
+                auto iter=cache.find(key);
+                if (iter!=cache.end() && pool[iter->second].timer==handle)
+                {
+                    // 条目已经被时间轮回收，removeEntry不能再取消它
+                    pool[iter->second].timer=TTL::NO_TIMER;
+                    removeEntry(iter->second);
+                    this->statistics.record(StatsEvent::EXPIRATION);
+                }
+            });
+            return now;
+        }
+
+        // 时间轮一次推进的步数有上限，长时间空闲后可能还没轮到回收，所以命中时再核对一次
+        bool isExpired(const std::uint32_t index,const std::uint64_t now) const
+        {
+            return pool[index].expireTick!=0 && pool[index].expireTick<=now;
+        }
+
+        // 批量读的实现，positions是要处理的下标（getMany传入0~count-1）
+        template<typename Positions>
+        void lookupBatch(std::span<const Key> keys,std::span<Value> values,const Positions& positions,std::vector<bool>& hits)
+        {
+            std::uint64_t HitCount=0;
+            if constexpr (LazyPromotion)
+            {
+                // 共享锁下不能用batchIndices（多个读线程会同时改它），逐个查找
+                const bool done=sharedLookup([&]
+                {
+                    for (const std::size_t i : positions)
+                    {
+                        auto iter=cache.find(keys[i]);
+                        if (iter==cache.end()) continue;
+                        values[i]=Storage::get(pool[iter->second].value);
+                        touch(iter->second);
+                        hits[i]=true;
+                        HitCount++;
+                    }
+                });
+                if (done)
+                {
+                    this->recordLookups(HitCount,positions.size());
+                    return;
+                }
+            }
+            std::lock_guard lock(mutex);
+            const std::uint64_t now=expireEntries();
+            batchIndices.clear();
+            for (const std::size_t i : positions)
+            {
+                auto iter=cache.find(keys[i]);
+                const std::uint32_t index=iter==cache.end()?NIL_INDEX:iter->second;
+                if (index!=NIL_INDEX)
+                {
+                    AlgorithmStandard::prefetch(&pool[index]);
+                }
+                batchIndices.push_back(index);
+            }
+            std::size_t j=0;
+            for (const std::size_t i : positions)
+            {
+                const std::uint32_t index=batchIndices[j++];
+                if (index==NIL_INDEX || isExpired(index,now)) continue;
+                // 过期的节点这里不删除，同一批里可能还有重复的key指向它，留给时间轮回收
+                values[i]=Storage::get(pool[index].value);
+                touch(index);
+                hits[i]=true;
+                HitCount++;
+            }
+            this->recordLookups(HitCount,batchIndices.size());
+        }
+
+        template<typename Positions>
+        void storeBatch(std::span<const Value> values,std::span<const Key> keys,const Positions& positions)
+        {
+            std::lock_guard lock(mutex);
+            expireEntries();
+            for (const std::size_t i : positions)
+            {
+                putUnlocked(values[i],keys[i]);
+            }
+        }
+
+    public:
+        ~LRUAlgorithm() override=default;
+
+        /*
+        weigher为空时按条目个数限制容量
+        设置了weigher时capacity是权重总和的上限（例如字节数），条目个数事先不知道，节点池和哈希表不预留，按需增长
+        */
+        explicit LRUAlgorithm(const std::size_t capacity=DEFAULT_CACHE_CAPACITY,AlgorithmStandard::Weigher<Key,Value> weigher={}):
+            pool(weigher?0:capacity),capacity(capacity),weigher(std::move(weigher)),totalWeight(0)
+        {
+            if (!this->weigher)
+            {
+                cache.reserve(capacity+1);
+                // 提前reserve（多留一个给插入时的占位）；FlatIndex删除时不留墓碑，之后put、淘汰反复多少次索引都不会扩容或重建
+            }
+        }
+        // 注意每次调用都会更新上次访问历史记录
+
+        /*
+        运行时调整容量
+        缩小：按LRU顺序从链表头部淘汰，直到不超过新容量，然后把剩下的节点按原顺序搬进一个更小的节点池，归还多余内存
+        扩大：一次性reserve节点池和哈希表，之后的插入不会反复扩容、rehash
+        设置了权重函数时newCapacity是新的权重上限，扩大时不预留
+        */
+        void resize(const std::size_t newCapacity)
+        {
+            std::lock_guard lock(mutex);
+            if (newCapacity<capacity)
+            {
+                while (totalWeight>newCapacity)
+                {
+                    evictFirstNode();
+                }
+                LRUNodePool<Key,StoredValue> NewPool(weigher?cache.size():newCapacity);
+                for (std::uint32_t index=pool.first(LRU_LIST);index!=LRU_LIST;index=pool[index].next)
+                {
+                    const std::uint32_t NewIndex=NewPool.allocate(pool[index].key,std::move(pool[index].value));
+                    NewPool[NewIndex].weight=pool[index].weight;
+                    NewPool[NewIndex].accessed=pool[index].accessed;
+                    NewPool[NewIndex].timer=pool[index].timer;
+                    NewPool[NewIndex].expireTick=pool[index].expireTick;
+                    NewPool.addNodeToLast(LRU_LIST,NewIndex);
+                    cache.find(NewPool[NewIndex].key)->second=NewIndex;
+                }
+                pool=std::move(NewPool);
+            }
+            else if (!weigher)
+            {
+                pool.reserve(newCapacity);
+                cache.reserve(newCapacity+1);
+            }
+            capacity=newCapacity;
+        }
+
+        std::size_t getCapacity()
+        {
+            std::lock_guard lock(mutex);
+            return capacity;
+        }
+
+        // 当前所有条目的权重总和，没有设置权重函数时就是条目个数
+        std::size_t getTotalWeight()
+        {
+            std::lock_guard lock(mutex);
+            return totalWeight;
+        }
+
+        // 时间轮里还在等待触发的条目数，不会超过带TTL的节点数
+        std::size_t getPendingTimers()
+        {
+            std::lock_guard lock(mutex);
+            return wheel.size();
+        }
+
+        // 一次加锁处理整批key：第一遍只查哈希表并预取命中的节点，第二遍再拷贝value、调整链表
+        std::vector<bool> getMany(std::span<const Key> keys,std::span<Value> values) override
+        {
+            const std::size_t count=std::min(keys.size(),values.size());
+            std::vector<bool> hits(count);
+            lookupBatch(keys,values,std::views::iota(std::size_t{0},count),hits);
+            return hits;
+        }
+
+        void putMany(std::span<const Value> values,std::span<const Key> keys) override
+        {
+            const std::size_t count=std::min(keys.size(),values.size());
+            storeBatch(values,keys,std::views::iota(std::size_t{0},count));
+        }
+
+        /*
+        只处理positions列出的那些下标，结果写回values/hits的同一位置
+        ShardedLRU把一批key按分片分组后直接交给分片，key和value都不用先拷贝到分片自己的数组里
+        */
+        void getManyAt(std::span<const Key> keys,std::span<Value> values,std::span<const std::size_t> positions,std::vector<bool>& hits)
+        {
+            lookupBatch(keys,values,positions,hits);
+        }
+
+        void putManyAt(std::span<const Value> values,std::span<const Key> keys,std::span<const std::size_t> positions)
+        {
+            storeBatch(values,keys,positions);
+        }
+
+        ValueHandle getHandle(const Key& key) override
+        {
+            CACHE_LATENCY_SCOPE(GET);
+            if constexpr (LazyPromotion)
+            {
+                ValueHandle handle;
+                const bool done=sharedLookup([&]
+                {
+                    auto iter=cache.find(key);
+                    if (iter==cache.end()) return;
+                    touch(iter->second);
+                    handle=Storage::handle(pool[iter->second].value);
+                });
+                if (done)
+                {
+                    this->recordLookup(handle!=nullptr);
+                    return handle;
+                }
+            }
+            std::lock_guard lock(mutex);
+            const std::uint64_t now=expireEntries();
+            auto iter=cache.find(key);
+            if (iter!=cache.end())
+            {
+                const std::uint32_t index=iter->second;
+                if (isExpired(index,now))
+                {
+                    removeEntry(index);
+                    this->statistics.record(StatsEvent::EXPIRATION);
+                    this->recordLookup(false);
+                    return nullptr;
+                }
+                touch(index);
+                this->recordLookup(true);
+                return Storage::handle(pool[index].value);
+            }
+            this->recordLookup(false);
+            return nullptr;
+        }
+
+        bool get(const Key& key, Value& value) override
+        {
+            CACHE_LATENCY_SCOPE(GET);
+            if constexpr (LazyPromotion)
+            {
+                bool hit=false;
+                const bool done=sharedLookup([&]
+                {
+                    auto iter=cache.find(key);
+                    if (iter==cache.end()) return;
+                    value=Storage::get(pool[iter->second].value);
+                    touch(iter->second);
+                    hit=true;
+                });
+                if (done)
+                {
+                    return this->recordLookup(hit);
+                }
+            }
+            std::lock_guard lock(mutex);
+            const std::uint64_t now=expireEntries();
+            auto iter=cache.find(key);
+            if (iter!=cache.end())
+            {
+                const std::uint32_t index=iter->second;
+                if (isExpired(index,now))
+                {
+                    removeEntry(index);
+                    this->statistics.record(StatsEvent::EXPIRATION);
+                    return this->recordLookup(false);
+                }
+                value=Storage::get(pool[index].value);
+                touch(index);
+                return this->recordLookup(true);
+            }
+            return this->recordLookup(false);
+        }
+
+        void put(const Value& val,const Key& key) override
+        {
+            putValue(val,key);
+        }
+
+        void put(Value&& val,const Key& key) override
+        {
+            putValue(std::move(val),key);
+        }
+
+        // key也是右值时：插入新key直接把key移动进索引和节点，不拷贝
+        void put(Value&& val,Key&& key)
+        {
+            putValue(std::move(val),std::move(key));
+        }
+
+        // 带TTL的写入，ttl之后这个key按未命中处理并由时间轮回收；之后再用不带TTL的put覆盖会取消过期
+        void put(const Value& val,const Key& key,const std::chrono::milliseconds ttl)
+        {
+            putWithTTL(val,key,ttl);
+        }
+
+        void put(Value&& val,const Key& key,const std::chrono::milliseconds ttl)
+        {
+            putWithTTL(std::move(val),key,ttl);
+        }
+
+        // 只有key不存在时才用args构造value（SharedValues=true时直接构造在shared_ptr的控制块里，否则构造后移动进节点）
+        // key已存在时什么也不做，返回false
+        template<typename... Args>
+        bool tryEmplace(const Key& key,Args&&... args)
+        {
+            CACHE_LATENCY_SCOPE(PUT);
+            std::lock_guard lock(mutex);
+            const std::uint64_t now=expireEntries();
+            auto [iter,inserted]=cache.try_emplace(key,NIL_INDEX);
+            if (!inserted)
+            {
+                if (!isExpired(iter->second,now))
+                {
+                    return false;
+                }
+                // 已过期但还没被回收的key视为不存在
+                removeEntry(iter->second);
+                this->statistics.record(StatsEvent::EXPIRATION);
+                iter=cache.try_emplace(key,NIL_INDEX).first;
+            }
+            this->recordPut(false);
+            AlgorithmStandard::PlaceholderGuard placeholder(cache,iter);
+            if (!insertNode(iter,Storage::make(std::forward<Args>(args)...)))
+            {
+                return false;
+            }
+            placeholder.release();
+            return true;
+        }
+    };
+
+    // 读多写少时用：命中只拿共享锁
+    template<typename Key,typename Value>
+    using LazyLRUAlgorithm=LRUAlgorithm<Key,Value,true>;
+
+    // 需要零拷贝getHandle时用：value放在shared_ptr里，句柄直接共享
+    template<typename Key,typename Value>
+    using SharedLRUAlgorithm=LRUAlgorithm<Key,Value,false,true>;
+}
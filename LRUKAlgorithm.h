@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include "AlgorithmStandard.h"
+#include "FlatIndex.h"
+#include "LRUAlgorithm.h"
+
+namespace LRU
+{
+    /*
+    LRU-K：数据要被访问K次才进入缓存队列，之前只记在访问历史队列里
+    一次顺序扫描中的冷key每个只访问一次，停在历史队列里，挤不掉缓存队列中的热点数据
+    历史队列也按LRU淘汰，容量单独指定；put带来的value先跟着历史记录保存，达到K次时直接带着value进入缓存
+    K=1时退化为普通的LRU
+    两条链表放在同一个LRUNodePool里，节点的list区分它在缓存队列还是历史队列，进入缓存只是换一条链表，不重新分配节点
+    */
+    template<typename Key,typename Value>
+    class LRUKAlgorithm final : public AlgorithmStandard::Algorithmstandard<Key,Value>
+    {
+        static constexpr std::uint32_t CACHE=0;
+        static constexpr std::uint32_t HISTORY=1;
+
+        // 历史队列里的节点要记住访问次数，以及put带来的value（get未命中留下的记录没有value）
+        struct Entry
+        {
+            Value value{};
+            std::uint32_t count=0;
+            bool hasValue=false;
+        };
+
+        using Index=AlgorithmStandard::FlatIndex<Key,std::uint32_t>;
+
+        Index cache; // 同时索引缓存队列和历史队列
+        LRUNodePool<Key,Entry> pool;
+        std::size_t listSize[2];
+        std::size_t capacity;
+        std::size_t historyCapacity;
+        std::uint32_t k;
+        AlgorithmStandard::TimedMutex<std::mutex> mutex{this->statistics};
+
+        void deleteFirst(const std::uint32_t list)
+        {
+            const std::uint32_t index=pool.first(list);
+            cache.erase(pool[index].key);
+            pool.removeNode(index);
+            pool.release(index);
+            listSize[list]--;
+        }
+
+        // 历史节点访问次数达到K：腾出位置后换到缓存队列尾部
+        void promote(const std::uint32_t index)
+        {
+            if (listSize[CACHE]>=capacity)
+            {
+                CACHE_LATENCY_SCOPE(EVICTION);
+                deleteFirst(CACHE);
+                this->statistics.record(AlgorithmStandard::StatsEvent::EVICTION);
+            }
+            listSize[HISTORY]--;
+            pool.moveNodeToLast(CACHE,index);
+            listSize[CACHE]++;
+            pool[index].value.count=0;
+            pool[index].value.hasValue=false;
+        }
+
+        /*
+        记一次访问，返回节点下标（新key会先在历史队列里建一个节点，访问次数为1）
+        iter是try_emplace的结果，新key已经占好了位置
+        historyCapacity为0时历史队列仍然至少留一个节点，否则K=1时新key没有地方中转
+        */
+        std::uint32_t recordAccess(typename Index::iterator iter,const bool inserted)
+        {
+            if (!inserted)
+            {
+                const std::uint32_t index=iter->second;
+                pool[index].value.count++;
+                pool.moveNodeToLast(HISTORY,index);
+                return index;
+            }
+            // 拷贝key、构造Value都可能抛出异常：先做完再腾位置，抛出时只需要由guard撤销占位
+            AlgorithmStandard::PlaceholderGuard placeholder(cache,iter);
+            Key NewKey=iter->first;
+            Entry NewEntry{Value{},1,false};
+            if (listSize[HISTORY]>0 && listSize[HISTORY]>=historyCapacity)
+            {
+                deleteFirst(HISTORY);
+                // FlatIndex的erase不会移动其他元素，iter仍然有效
+            }
+            const std::uint32_t NewIndex=pool.allocate(std::move(NewKey),std::move(NewEntry));
+            iter->second=NewIndex;
+            pool.addNodeToLast(HISTORY,NewIndex);
+            listSize[HISTORY]++;
+            placeholder.release();
+            return NewIndex;
+        }
+
+        template<typename V>
+        void putValue(V&& val,const Key& key)
+        {
+            CACHE_LATENCY_SCOPE(PUT);
+            std::lock_guard lock(mutex);
+            if (capacity==0)
+            {
+                return;
+            }
+            auto [iter,inserted]=cache.try_emplace(key,NIL_INDEX);
+            this->recordPut(!inserted && pool[iter->second].list==CACHE);
+            if (!inserted && pool[iter->second].list==CACHE)
+            {
+                pool[iter->second].value.value=std::forward<V>(val);
+                pool.moveNodeToLast(CACHE,iter->second);
+                return;
+            }
+            std::uint32_t index;
+            if (!inserted && !pool[iter->second].value.hasValue)
+            {
+                // 记录是get未命中留下的：这次put是未命中后的回填，和那次get算同一次访问，只带上value
+                index=iter->second;
+                pool.moveNodeToLast(HISTORY,index);
+            }
+            else
+            {
+                index=recordAccess(iter,inserted);
+            }
+            pool[index].value.value=std::forward<V>(val);
+            pool[index].value.hasValue=true;
+            if (pool[index].value.count>=k)
+            {
+                promote(index);
+            }
+        }
+
+    public:
+        explicit LRUKAlgorithm(const std::size_t capacity=DEFAULT_CACHE_CAPACITY,const std::uint32_t k=2):
+            LRUKAlgorithm(capacity,k,capacity){}
+
+        // historyCapacity是历史队列最多记住的key个数
+        LRUKAlgorithm(const std::size_t capacity,const std::uint32_t k,const std::size_t historyCapacity):
+            pool(capacity+historyCapacity+1,2),listSize{0,0},capacity(capacity),historyCapacity(historyCapacity),k(k)
+        {
+            cache.reserve(capacity+historyCapacity+1);
+        }
+        ~LRUKAlgorithm() override=default;
+
+        /*
+        缓存队列命中直接返回
+        否则记一次访问；历史记录带着value并且访问次数达到K时，这次get就把它放进缓存并返回命中
+        */
+        bool get(const Key& key, Value& value) override
+        {
+            CACHE_LATENCY_SCOPE(GET);
+            std::lock_guard lock(mutex);
+            if (capacity==0)
+            {
+                return this->recordLookup(false);
+            }
+            auto [iter,inserted]=cache.try_emplace(key,NIL_INDEX);
+            if (!inserted && pool[iter->second].list==CACHE)
+            {
+                const std::uint32_t index=iter->second;
+                value=pool[index].value.value;
+                pool.moveNodeToLast(CACHE,index);
+                return this->recordLookup(true);
+            }
+            const std::uint32_t index=recordAccess(iter,inserted);
+            if (pool[index].value.hasValue && pool[index].value.count>=k)
+            {
+                value=pool[index].value.value;
+                promote(index);
+                return this->recordLookup(true);
+            }
+            return this->recordLookup(false);
+        }
+
+        void put(const Value& val,const Key& key) override
+        {
+            putValue(val,key);
+        }
+
+        void put(Value&& val,const Key& key) override
+        {
+            putValue(std::move(val),key);
+        }
+
+        std::size_t getCapacity()
+        {
+            std::lock_guard lock(mutex);
+            return capacity;
+        }
+    };
+}
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+
+/*
+引擎内部的延迟直方图，默认关闭
+CMake配置时加 -DCACHE_LATENCY_HISTOGRAM=ON（或者编译时定义同名宏）才会启用，
+关闭时CACHE_LATENCY_SCOPE展开为空语句，LatencyRecorder是空类，get/put路径上没有任何额外代码
+*/
+#ifdef CACHE_LATENCY_HISTOGRAM
+#define CACHE_LATENCY_CONCAT_IMPL(a,b) a##b
+#define CACHE_LATENCY_CONCAT(a,b) CACHE_LATENCY_CONCAT_IMPL(a,b)
+// 从这一行到所在作用域结束的耗时记进对应事件的直方图，只能在Algorithmstandard的派生类成员函数里使用
+#define CACHE_LATENCY_SCOPE(event) \
+    const AlgorithmStandard::LatencyScope CACHE_LATENCY_CONCAT(latencyScope,__LINE__)(this->latencyRecorder,AlgorithmStandard::LatencyEvent::event)
+#else
+#define CACHE_LATENCY_SCOPE(event) ((void)0)
+#endif
+
+namespace AlgorithmStandard
+{
+    enum class LatencyEvent : std::uint8_t
+    {
+        GET,
+        PUT,
+        EVICTION, // 一次容量淘汰（包括挑选淘汰对象的过程）
+        AGING,    // 一次LFU老化（ReduceAllNodeFrequency）
+        COUNT
+    };
+
+    /*
+    HDR风格的对数-线性分桶：按最高位分成若干段，每段再等分成SUB_BUCKETS个桶
+    小于2*SUB_BUCKETS纳秒的值每纳秒一个桶，更大的值相对误差不超过1/SUB_BUCKETS（约3%）
+    最大记录到2^MAX_BITS纳秒（约18分钟），更大的值都算进最后一个桶
+    这个类本身不是线程安全的，用作快照和合并；并发记录见AtomicLatencyHistogram
+    */
+    class LatencyHistogram
+    {
+    public:
+        static constexpr unsigned SUB_BUCKET_BITS=5;
+        static constexpr std::size_t SUB_BUCKETS=std::size_t{1}<<SUB_BUCKET_BITS;
+        static constexpr unsigned MAX_BITS=40;
+        static constexpr std::size_t BUCKETS=(MAX_BITS-SUB_BUCKET_BITS+1)*SUB_BUCKETS;
+
+        static std::size_t bucketOf(const std::uint64_t nanos)
+        {
+            if (nanos>>MAX_BITS!=0)
+            {
+                return BUCKETS-1;
+            }
+            const unsigned msb=static_cast<unsigned>(std::bit_width(nanos));
+            if (msb<=SUB_BUCKET_BITS+1)
+            {
+                return static_cast<std::size_t>(nanos);
+            }
+            const unsigned shift=msb-SUB_BUCKET_BITS-1;
+            // 保留最高的SUB_BUCKET_BITS+1位，去掉最高位后就是段内的桶号
+            return (shift+1)*SUB_BUCKETS+static_cast<std::size_t>((nanos>>shift)-SUB_BUCKETS);
+        }
+
+        // 桶里最大的值，报告分位数时用它（偏保守）
+        static std::uint64_t bucketUpperBound(const std::size_t bucket)
+        {
+            const std::size_t group=bucket>>SUB_BUCKET_BITS;
+            if (group<=1)
+            {
+                return bucket;
+            }
+            const unsigned shift=static_cast<unsigned>(group-1);
+            const std::uint64_t mantissa=(bucket&(SUB_BUCKETS-1))|SUB_BUCKETS;
+            return ((mantissa+1)<<shift)-1;
+        }
+
+        void add(const std::size_t bucket,const std::uint64_t count)
+        {
+            counts[bucket]+=count;
+            total+=count;
+        }
+        void updateMax(const std::uint64_t nanos)
+        {
+            if (nanos>maxNanos) maxNanos=nanos;
+        }
+
+        std::uint64_t count() const
+        {
+            return total;
+        }
+        std::uint64_t max() const
+        {
+            return maxNanos;
+        }
+
+        // p取0~1，返回第p分位的延迟（纳秒）；没有记录时返回0
+        std::uint64_t percentile(const double p) const
+        {
+            if (total==0)
+            {
+                return 0;
+            }
+            auto rank=static_cast<std::uint64_t>(p*static_cast<double>(total));
+            if (rank>=total) rank=total-1;
+            std::uint64_t seen=0;
+            for (std::size_t i=0;i<BUCKETS;i++)
+            {
+                seen+=counts[i];
+                if (seen>rank)
+                {
+                    const std::uint64_t bound=bucketUpperBound(i);
+                    return bound<maxNanos?bound:maxNanos;
+                }
+            }
+            return maxNanos;
+        }
+
+        LatencyHistogram& operator+=(const LatencyHistogram& other)
+        {
+            for (std::size_t i=0;i<BUCKETS;i++)
+            {
+                counts[i]+=other.counts[i];
+            }
+            total+=other.total;
+            updateMax(other.maxNanos);
+            return *this;
+        }
+
+    private:
+        std::array<std::uint64_t,BUCKETS> counts{};
+        std::uint64_t total=0;
+        std::uint64_t maxNanos=0;
+    };
+
+    // 并发记录用的直方图：每个桶是一个relaxed原子计数，不同延迟落在不同的桶里，争用比单个计数器小得多
+    class AtomicLatencyHistogram
+    {
+        std::array<std::atomic<std::uint64_t>,LatencyHistogram::BUCKETS> counts{};
+        std::atomic<std::uint64_t> maxNanos{0};
+
+    public:
+        void record(const std::uint64_t nanos)
+        {
+            counts[LatencyHistogram::bucketOf(nanos)].fetch_add(1,std::memory_order_relaxed);
+            std::uint64_t current=maxNanos.load(std::memory_order_relaxed);
+            while (nanos>current && !maxNanos.compare_exchange_weak(current,nanos,std::memory_order_relaxed))
+            {
+            }
+        }
+
+        LatencyHistogram snapshot() const
+        {
+            LatencyHistogram histogram;
+            for (std::size_t i=0;i<LatencyHistogram::BUCKETS;i++)
+            {
+                const std::uint64_t count=counts[i].load(std::memory_order_relaxed);
+                if (count!=0) histogram.add(i,count);
+            }
+            histogram.updateMax(maxNanos.load(std::memory_order_relaxed));
+            return histogram;
+        }
+    };
+
+    // latencies()返回的快照：每种事件一个直方图，可以相加（ShardedLRU合并各分片）
+    struct LatencyReport
+    {
+        std::array<LatencyHistogram,static_cast<std::size_t>(LatencyEvent::COUNT)> histograms;
+
+        const LatencyHistogram& operator[](const LatencyEvent event) const
+        {
+            return histograms[static_cast<std::size_t>(event)];
+        }
+        LatencyHistogram& operator[](const LatencyEvent event)
+        {
+            return histograms[static_cast<std::size_t>(event)];
+        }
+
+        LatencyReport& operator+=(const LatencyReport& other)
+        {
+            for (std::size_t i=0;i<histograms.size();i++)
+            {
+                histograms[i]+=other.histograms[i];
+            }
+            return *this;
+        }
+
+        // 每种事件一行：次数、p50/p90/p99/p99.9/最大值（纳秒），没有记录的事件不输出
+        void print(std::ostream& out) const
+        {
+            static constexpr const char* NAMES[]={"get","put","eviction","aging"};
+            out<<std::left<<std::setw(10)<<"事件"<<std::right<<std::setw(12)<<"次数"<<std::setw(10)<<"p50"
+               <<std::setw(10)<<"p90"<<std::setw(10)<<"p99"<<std::setw(10)<<"p99.9"<<std::setw(12)<<"最大"<<std::endl;
+            for (std::size_t i=0;i<histograms.size();i++)
+            {
+                const LatencyHistogram& histogram=histograms[i];
+                if (histogram.count()==0) continue;
+                out<<std::left<<std::setw(10)<<NAMES[i]<<std::right<<std::setw(12)<<histogram.count()
+                   <<std::setw(10)<<histogram.percentile(0.5)<<std::setw(10)<<histogram.percentile(0.9)
+                   <<std::setw(10)<<histogram.percentile(0.99)<<std::setw(10)<<histogram.percentile(0.999)
+                   <<std::setw(12)<<histogram.max()<<std::endl;
+            }
+        }
+    };
+
+#ifdef CACHE_LATENCY_HISTOGRAM
+    class LatencyRecorder
+    {
+        std::array<AtomicLatencyHistogram,static_cast<std::size_t>(LatencyEvent::COUNT)> histograms;
+
+    public:
+        void record(const LatencyEvent event,const std::uint64_t nanos)
+        {
+            histograms[static_cast<std::size_t>(event)].record(nanos);
+        }
+
+        LatencyReport report() const
+        {
+            LatencyReport report;
+            for (std::size_t i=0;i<histograms.size();i++)
+            {
+                report.histograms[i]=histograms[i].snapshot();
+            }
+            return report;
+        }
+    };
+
+    // 构造时读一次时钟，析构时把经过的时间记进直方图
+    class LatencyScope
+    {
+        LatencyRecorder& recorder;
+        LatencyEvent event;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        LatencyScope(LatencyRecorder& recorder,const LatencyEvent event):
+            recorder(recorder),event(event),start(std::chrono::steady_clock::now()){}
+        ~LatencyScope()
+        {
+            const auto elapsed=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-start).count();
+            recorder.record(event,static_cast<std::uint64_t>(elapsed));
+        }
+        LatencyScope(const LatencyScope&)=delete;
+        LatencyScope& operator=(const LatencyScope&)=delete;
+    };
+#else
+    // 关闭时的空实现，配合[[no_unique_address]]不占对象空间
+    class LatencyRecorder
+    {
+    public:
+        void record(LatencyEvent,std::uint64_t){}
+        LatencyReport report() const
+        {
+            return {};
+        }
+    };
+#endif
+}
@@ -0,0 +1,304 @@
+#pragma once
+
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "AlgorithmStandard.h"
+#include "FlatIndex.h"
+
+namespace Policy
+{
+    /*
+    编译期组合的缓存：淘汰策略、锁、哈希函数都是模板参数，不经过虚函数
+    get/put整条路径对编译器可见，可以完全内联；需要通过Algorithmstandard统一调用时再套一层VirtualCache
+    key和value存放在连续的槽位数组里，策略只和槽位下标打交道，不知道key和value的类型
+    */
+
+    // 淘汰策略：用容量构造，插入/命中/删除时收到通知，淘汰时给出一个槽位下标
+    template<typename P>
+    concept EvictionPolicy=requires(P policy,const std::uint32_t index,const std::size_t capacity)
+    {
+        P(capacity);
+        policy.onInsert(index);
+        policy.onHit(index);
+        policy.onRemove(index);
+        {policy.victim()}->std::convertible_to<std::uint32_t>;
+    };
+
+    // 锁：满足BasicLockable即可，std::mutex、std::shared_mutex、NullLock都可以
+    template<typename L>
+    concept CacheLock=requires(L lock)
+    {
+        lock.lock();
+        lock.unlock();
+    };
+
+    // 单线程使用时的空锁，加锁解锁都是空操作，编译后完全消失
+    struct NullLock
+    {
+        void lock(){}
+        void unlock(){}
+    };
+
+    // 统计：默认用和其他算法相同的分条计数器；不需要统计时换成NullStats，计数调用编译后完全消失
+    struct NullStats
+    {
+        void record(AlgorithmStandard::StatsEvent,std::uint64_t=1){}
+        AlgorithmStandard::CacheStats snapshot() const
+        {
+            return {};
+        }
+    };
+
+    /*
+    key到槽位下标的索引，作为Cache的Index参数：默认用std::unordered_map，
+    FlatSlotIndex换成扁平哈希索引（FlatIndex.h），查找时少一次链表节点的指针跳转
+    */
+    template<typename Key,typename Hasher>
+    using HashIndex=std::unordered_map<Key,std::uint32_t,Hasher>;
+    template<typename Key,typename Hasher>
+    using FlatSlotIndex=AlgorithmStandard::FlatIndex<Key,std::uint32_t,Hasher>;
+
+    /*
+    下标双向链表：槽位i的前后指针放在prev[i]/next[i]，下标capacity是环形哨兵
+    哨兵的next是最早进入（或最久未访问）的槽位
+    */
+    class IndexList
+    {
+        std::vector<std::uint32_t> prev;
+        std::vector<std::uint32_t> next;
+        std::uint32_t sentinel;
+
+    public:
+        explicit IndexList(const std::size_t capacity):
+            prev(capacity+1),next(capacity+1),sentinel(static_cast<std::uint32_t>(capacity))
+        {
+            prev[sentinel]=sentinel;
+            next[sentinel]=sentinel;
+        }
+
+        void pushBack(const std::uint32_t index)
+        {
+            const std::uint32_t last=prev[sentinel];
+            prev[index]=last;
+            next[index]=sentinel;
+            next[last]=index;
+            prev[sentinel]=index;
+        }
+
+        void remove(const std::uint32_t index)
+        {
+            next[prev[index]]=next[index];
+            prev[next[index]]=prev[index];
+        }
+
+        std::uint32_t front() const
+        {
+            return next[sentinel];
+        }
+    };
+
+    // 命中时移到链表尾部，淘汰链表头部
+    class LRUPolicy
+    {
+        IndexList list;
+
+    public:
+        explicit LRUPolicy(const std::size_t capacity):list(capacity){}
+
+        void onInsert(const std::uint32_t index)
+        {
+            list.pushBack(index);
+        }
+        void onHit(const std::uint32_t index)
+        {
+            list.remove(index);
+            list.pushBack(index);
+        }
+        void onRemove(const std::uint32_t index)
+        {
+            list.remove(index);
+        }
+        std::uint32_t victim() const
+        {
+            return list.front();
+        }
+    };
+
+    // 按进入顺序淘汰，命中不做任何事
+    class FIFOPolicy
+    {
+        IndexList list;
+
+    public:
+        explicit FIFOPolicy(const std::size_t capacity):list(capacity){}
+
+        void onInsert(const std::uint32_t index)
+        {
+            list.pushBack(index);
+        }
+        void onHit(std::uint32_t){}
+        void onRemove(const std::uint32_t index)
+        {
+            list.remove(index);
+        }
+        std::uint32_t victim() const
+        {
+            return list.front();
+        }
+    };
+
+    template<EvictionPolicy P,typename Key,typename Value,typename Hasher=std::hash<Key>,CacheLock Lock=std::mutex,
+             typename Stats=AlgorithmStandard::StatsCounter,template<typename,typename> class Index=HashIndex>
+    class Cache
+    {
+        struct Slot
+        {
+            Key key;
+            Value value;
+        };
+        using IndexMap=Index<Key,Hasher>;
+
+        IndexMap index;
+        std::vector<Slot> slots;
+        P policy;
+        std::size_t capacity;
+        Lock mutex;
+        Stats statistics;
+
+        /*
+        新key已经用try_emplace占好位置；没满时追加槽位，满了就把淘汰者的槽位原地换成新key
+        新槽位的key、value先拷贝好，可能抛出异常的步骤都在改动淘汰者之前，抛出时由调用方撤销占位
+        */
+        template<typename V>
+        void insert(typename IndexMap::iterator iter,V&& val)
+        {
+            Slot fresh{iter->first,std::forward<V>(val)};
+            std::uint32_t slot;
+            if (slots.size()<capacity)
+            {
+                slot=static_cast<std::uint32_t>(slots.size());
+                slots.push_back(std::move(fresh));
+            }
+            else
+            {
+                slot=policy.victim();
+                policy.onRemove(slot);
+                index.erase(slots[slot].key);
+                statistics.record(AlgorithmStandard::StatsEvent::EVICTION);
+                slots[slot]=std::move(fresh);
+            }
+            iter->second=slot;
+            policy.onInsert(slot);
+        }
+
+        template<typename V>
+        void putValue(V&& val,const Key& key)
+        {
+            std::lock_guard lock(mutex);
+            if (capacity==0)
+            {
+                return;
+            }
+            auto [iter,inserted]=index.try_emplace(key,0);
+            statistics.record(AlgorithmStandard::StatsEvent::PUT);
+            if (!inserted)
+            {
+                statistics.record(AlgorithmStandard::StatsEvent::UPDATE);
+                slots[iter->second].value=std::forward<V>(val);
+                policy.onHit(iter->second);
+                return;
+            }
+            AlgorithmStandard::PlaceholderGuard placeholder(index,iter);
+            insert(iter,std::forward<V>(val));
+            placeholder.release();
+        }
+
+    public:
+        using KeyType=Key;
+        using ValueType=Value;
+
+        explicit Cache(const std::size_t capacity=DEFAULT_CACHE_CAPACITY):policy(capacity),capacity(capacity)
+        {
+            index.reserve(capacity+1);
+            slots.reserve(capacity);
+        }
+
+        bool get(const Key& key,Value& value)
+        {
+            std::lock_guard lock(mutex);
+            auto iter=index.find(key);
+            if (iter==index.end())
+            {
+                statistics.record(AlgorithmStandard::StatsEvent::MISS);
+                return false;
+            }
+            value=slots[iter->second].value;
+            policy.onHit(iter->second);
+            statistics.record(AlgorithmStandard::StatsEvent::HIT);
+            return true;
+        }
+
+        void put(const Value& val,const Key& key)
+        {
+            putValue(val,key);
+        }
+
+        void put(Value&& val,const Key& key)
+        {
+            putValue(std::move(val),key);
+        }
+
+        std::size_t getCapacity() const
+        {
+            return capacity;
+        }
+
+        // 锁是模板参数，这里不统计等锁时间
+        AlgorithmStandard::CacheStats stats() const
+        {
+            return statistics.snapshot();
+        }
+    };
+
+    // 把编译期组合的Cache包装成Algorithmstandard，只有需要统一接口（例如放进测试列表）时才付出虚函数的代价
+    template<typename C>
+    class VirtualCache final : public AlgorithmStandard::Algorithmstandard<typename C::KeyType,typename C::ValueType>
+    {
+        using Key=typename C::KeyType;
+        using Value=typename C::ValueType;
+
+        C cache;
+
+    public:
+        explicit VirtualCache(const std::size_t capacity=DEFAULT_CACHE_CAPACITY):cache(capacity){}
+        ~VirtualCache() override=default;
+
+        bool get(const Key& key,Value& value) override
+        {
+            return cache.get(key,value);
+        }
+        void put(const Value& val,const Key& key) override
+        {
+            cache.put(val,key);
+        }
+        void put(Value&& val,const Key& key) override
+        {
+            cache.put(std::move(val),key);
+        }
+
+        std::size_t getCapacity() const
+        {
+            return cache.getCapacity();
+        }
+
+        AlgorithmStandard::CacheStats stats() const override
+        {
+            return cache.stats();
+        }
+    };
+}
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+#include "AlgorithmStandard.h"
+#include "FlatIndex.h"
+
+namespace S3FIFO
+{
+    // 定长环形队列，容量向上取到2的幂，下标用位与代替取模；head/tail只增不减，差值就是元素个数
+    template<typename T>
+    class RingQueue
+    {
+        std::vector<T> items;
+        std::size_t mask;
+        std::size_t head;
+        std::size_t tail;
+
+    public:
+        explicit RingQueue(const std::size_t capacity):
+            items(std::bit_ceil(std::max<std::size_t>(capacity,1))),mask(items.size()-1),head(0),tail(0){}
+
+        // 调用者保证不会超过构造时的容量
+        void push(T item)
+        {
+            items[tail&mask]=std::move(item);
+            tail++;
+        }
+        T pop()
+        {
+            return std::move(items[head++&mask]);
+        }
+        std::size_t size() const
+        {
+            return tail-head;
+        }
+        bool empty() const
+        {
+            return head==tail;
+        }
+    };
+
+    /*
+    S3-FIFO：三个FIFO队列
+    S（small）：新数据先进入S，约占容量的10%，大多数只访问一次的数据在这里就被淘汰，不会进入M
+    M（main）：在S里被访问过的数据、以及幽灵命中的数据进入M；M的队头被访问过时不淘汰，频率减一后重新放回队尾
+    G（ghost）：从S淘汰的key，只保留key，容量和M相同；G里的key再次写入时直接进入M
+    每个条目有一个0~3的访问频率，命中只把频率加一（原子操作，共享锁），不调整任何队列
+    条目放在固定的槽位数组里，队列里保存的只是槽位下标；队列只在写入和淘汰时变动，这两者持有独占锁
+    */
+    template<typename Key,typename Value>
+    class S3FIFOAlgorithm final : public AlgorithmStandard::Algorithmstandard<Key,Value>
+    {
+        static constexpr std::uint8_t MAX_FREQUENCY=3;
+        static constexpr std::uint8_t MOVE_TO_MAIN_THRESHOLD=1; // 在S中至少被访问过这么多次才进入M
+
+        struct Slot
+        {
+            Key key;
+            Value value;
+            std::uint8_t frequency;
+        };
+
+        using Index=AlgorithmStandard::FlatIndex<Key,std::uint32_t>;
+        using GhostIndex=AlgorithmStandard::FlatIndex<Key,std::uint64_t>;
+
+        Index cache; // key到槽位下标
+        std::vector<Slot> slots;
+        std::vector<std::uint32_t> freeSlots;
+        RingQueue<std::uint32_t> smallQueue;
+        RingQueue<std::uint32_t> mainQueue;
+        /*
+        幽灵队列按写入序号环形覆盖：第n个幽灵写在ghostKeys[n%ghostCapacity]，覆盖掉第n-ghostCapacity个
+        ghosts记录每个幽灵key最近一次进入G时的序号，被覆盖的条目序号对不上时说明key之后又进过G，不删除
+        */
+        GhostIndex ghosts;
+        std::vector<Key> ghostKeys;
+        std::uint64_t ghostCount;
+        std::size_t capacity;
+        std::size_t smallCapacity;
+        AlgorithmStandard::TimedMutex<std::shared_mutex> mutex{this->statistics};
+
+        // 频率饱和加一：已经到上限就不写，避免多个读线程反复争同一条缓存行
+        static void increaseFrequency(std::uint8_t& frequency)
+        {
+            std::atomic_ref<std::uint8_t> counter(frequency);
+            std::uint8_t current=counter.load(std::memory_order_relaxed);
+            while (current<MAX_FREQUENCY && !counter.compare_exchange_weak(current,current+1,std::memory_order_relaxed))
+            {
+            }
+        }
+
+        void addGhost(const Key& key)
+        {
+            if (ghostKeys.empty())
+            {
+                return;
+            }
+            const std::size_t position=ghostCount%ghostKeys.size();
+            if (ghostCount>=ghostKeys.size())
+            {
+                auto iter=ghosts.find(ghostKeys[position]);
+                if (iter!=ghosts.end() && iter->second==ghostCount-ghostKeys.size())
+                {
+                    ghosts.erase(iter);
+                }
+            }
+            ghostKeys[position]=key;
+            ghosts.try_emplace(key,ghostCount).first->second=ghostCount;
+            ghostCount++;
+        }
+
+        void releaseSlot(const std::uint32_t slot)
+        {
+            cache.erase(slots[slot].key);
+            slots[slot].value=Value{};
+            freeSlots.push_back(slot);
+            this->statistics.record(AlgorithmStandard::StatsEvent::EVICTION);
+        }
+
+        // S的队头访问过就移到M，否则淘汰并记进G；S里的条目全都移走了还没淘汰成功就改从M淘汰
+        bool evictSmall()
+        {
+            while (!smallQueue.empty())
+            {
+                const std::uint32_t slot=smallQueue.pop();
+                if (slots[slot].frequency>=MOVE_TO_MAIN_THRESHOLD)
+                {
+                    slots[slot].frequency=0;
+                    mainQueue.push(slot);
+                    continue;
+                }
+                addGhost(slots[slot].key);
+                releaseSlot(slot);
+                return true;
+            }
+            return false;
+        }
+
+        // M的队头访问过就频率减一放回队尾（reinsertion），频率最多为3，每个条目最多被放回3次，循环一定会结束
+        void evictMain()
+        {
+            while (true)
+            {
+                const std::uint32_t slot=mainQueue.pop();
+                if (slots[slot].frequency>0)
+                {
+                    slots[slot].frequency--;
+                    mainQueue.push(slot);
+                    continue;
+                }
+                releaseSlot(slot);
+                return;
+            }
+        }
+
+        void evict()
+        {
+            CACHE_LATENCY_SCOPE(EVICTION);
+            if ((smallQueue.size()>=smallCapacity || mainQueue.empty()) && evictSmall())
+            {
+                return;
+            }
+            evictMain();
+        }
+
+        template<typename V>
+        void putValue(V&& val,const Key& key)
+        {
+            CACHE_LATENCY_SCOPE(PUT);
+            std::lock_guard lock(mutex);
+            if (capacity==0)
+            {
+                return;
+            }
+            auto [iter,inserted]=cache.try_emplace(key,0);
+            this->recordPut(!inserted);
+            if (!inserted)
+            {
+                Slot& slot=slots[iter->second];
+                slot.value=std::forward<V>(val);
+                increaseFrequency(slot.frequency);
+                return;
+            }
+            // 新槽位先构造好再淘汰：拷贝key、value抛出异常时缓存没有任何变化，只需要由guard撤销占位
+            AlgorithmStandard::PlaceholderGuard placeholder(cache,iter);
+            Slot fresh{key,std::forward<V>(val),0};
+            const bool ghostHit=ghosts.erase(key)!=0;
+            // 先把自己从G里摘掉，淘汰时往G里写新幽灵不会影响它
+            if (freeSlots.empty())
+            {
+                evict();
+                // FlatIndex的erase不会移动其他元素，iter仍然有效
+            }
+            const std::uint32_t slot=freeSlots.back();
+            freeSlots.pop_back();
+            slots[slot]=std::move(fresh);
+            iter->second=slot;
+            placeholder.release();
+            if (ghostHit)
+            {
+                mainQueue.push(slot);
+            }
+            else
+            {
+                smallQueue.push(slot);
+            }
+        }
+
+    public:
+        /*
+        S取容量的10%（至少1个），G记住的key个数和M的容量相同
+        S和M的队列都按总容量分配，条目在两者之间移动时不会放不下
+        */
+        explicit S3FIFOAlgorithm(const std::size_t capacity=DEFAULT_CACHE_CAPACITY):
+            slots(capacity),smallQueue(capacity),mainQueue(capacity),ghostKeys(capacity-std::min(capacity,std::max<std::size_t>(capacity/10,1))),
+            ghostCount(0),capacity(capacity),smallCapacity(std::max<std::size_t>(capacity/10,1))
+        {
+            cache.reserve(capacity+1);
+            ghosts.reserve(ghostKeys.size());
+            freeSlots.reserve(capacity);
+            for (std::size_t i=capacity;i>0;i--)
+            {
+                freeSlots.push_back(static_cast<std::uint32_t>(i-1));
+                // 倒着放，先分配下标小的槽位
+            }
+        }
+        ~S3FIFOAlgorithm() override=default;
+
+        bool get(const Key& key, Value& value) override
+        {
+            CACHE_LATENCY_SCOPE(GET);
+            std::shared_lock lock(mutex);
+            auto iter=cache.find(key);
+            if (iter==cache.end())
+            {
+                return this->recordLookup(false);
+            }
+            Slot& slot=slots[iter->second];
+            value=slot.value;
+            increaseFrequency(slot.frequency);
+            return this->recordLookup(true);
+        }
+
+        void put(const Value& val,const Key& key) override
+        {
+            putValue(val,key);
+        }
+
+        void put(Value&& val,const Key& key) override
+        {
+            putValue(std::move(val),key);
+        }
+
+        std::size_t getCapacity()
+        {
+            std::shared_lock lock(mutex);
+            return capacity;
+        }
+    };
+}
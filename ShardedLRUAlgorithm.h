@@ -0,0 +1,232 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <utility>
+#include <vector>
+#include "LRUAlgorithm.h"
+#include "AlgorithmStandard.h"
+
+namespace LRU
+{
+    // 一般CPU的缓存行大小，分片按它对齐，避免相邻分片的锁落在同一缓存行上互相干扰（伪共享）
+    inline constexpr std::size_t CACHE_LINE_SIZE=64;
+
+    /*
+    分片LRU：按key的哈希把数据分到N个互相独立的LRUAlgorithm上
+    每个分片有自己的锁和自己那一份容量，不同分片上的get/put可以真正并行
+    代价是淘汰只在分片内部是严格LRU，整体上是近似LRU
+    SharedValues和LRUAlgorithm的同名参数一样，决定getHandle是否零拷贝
+    */
+    template<typename Key,typename Value,std::size_t N,bool SharedValues=false>
+    class ShardedLRU final : public AlgorithmStandard::Algorithmstandard<Key,Value>
+    {
+        static_assert(N>0,"ShardedLRU至少需要一个分片");
+
+        struct alignas(CACHE_LINE_SIZE) Shard
+        {
+            LRUAlgorithm<Key,Value,false,SharedValues> lru;
+            Shard(const std::size_t capacity,const AlgorithmStandard::Weigher<Key,Value>& weigher):lru(capacity,weigher){}
+        };
+
+        std::array<Shard,N> shards;
+
+        // 第i个分片分到的容量，余数分给前面的分片，保证总容量和构造参数完全一致
+        static std::size_t sliceOf(const std::size_t capacity,const std::size_t i)
+        {
+            return capacity/N+(i<capacity%N?1:0);
+        }
+
+        template<std::size_t... I>
+        static std::array<Shard,N> makeShards(const std::size_t capacity,const AlgorithmStandard::Weigher<Key,Value>& weigher,std::index_sequence<I...>)
+        {
+            return {{Shard(sliceOf(capacity,I),weigher)...}};
+        }
+
+        static std::size_t shardIndex(const Key& key)
+        {
+            // std::hash<int>是恒等映射，先乘一个奇数常量再取高位，把相邻的key打散到不同分片
+            const std::uint64_t h=static_cast<std::uint64_t>(std::hash<Key>{}(key))*0x9E3779B97F4A7C15ULL;
+            return (h>>32)%N;
+        }
+        Shard& shardFor(const Key& key)
+        {
+            return shards[shardIndex(key)];
+        }
+
+        /*
+        批量操作的分组结果：对下标按分片做一次计数排序，同一分片的下标在order里连续存放
+        第s个分片的下标是order[offsets[s], offsets[s+1])
+        */
+        struct BatchPlan
+        {
+            std::vector<std::size_t> order;
+            std::vector<std::size_t> shardOf;
+            std::array<std::size_t,N+1> offsets{};
+
+            std::span<const std::size_t> positionsOf(const std::size_t s) const
+            {
+                return std::span<const std::size_t>(order).subspan(offsets[s],offsets[s+1]-offsets[s]);
+            }
+        };
+
+        // 分组用的数组是线程局部的，同一个线程反复调用批量接口时复用内存，不会每批都分配
+        static const BatchPlan& planBatch(std::span<const Key> keys)
+        {
+            thread_local BatchPlan plan;
+            plan.order.resize(keys.size());
+            plan.shardOf.resize(keys.size());
+            plan.offsets.fill(0);
+            for (std::size_t i=0;i<keys.size();i++)
+            {
+                plan.shardOf[i]=shardIndex(keys[i]);
+                plan.offsets[plan.shardOf[i]+1]++;
+            }
+            for (std::size_t s=0;s<N;s++)
+            {
+                plan.offsets[s+1]+=plan.offsets[s];
+            }
+            std::array<std::size_t,N> next;
+            std::copy_n(plan.offsets.begin(),N,next.begin());
+            for (std::size_t i=0;i<keys.size();i++)
+            {
+                plan.order[next[plan.shardOf[i]]++]=i;
+            }
+            return plan;
+        }
+
+    public:
+        // 设置了weigher时capacity是权重总和的上限，同样按分片切分，每个分片各自按权重淘汰
+        explicit ShardedLRU(const std::size_t capacity=DEFAULT_CACHE_CAPACITY,const AlgorithmStandard::Weigher<Key,Value>& weigher={}):
+            shards(makeShards(capacity,weigher,std::make_index_sequence<N>{}))
+        {
+        }
+        ~ShardedLRU() override=default;
+
+        bool get(const Key& key, Value& value) override
+        {
+            return shardFor(key).lru.get(key,value);
+        }
+
+        void put(const Value& val,const Key& key) override
+        {
+            shardFor(key).lru.put(val,key);
+        }
+
+        void put(Value&& val,const Key& key) override
+        {
+            shardFor(key).lru.put(std::move(val),key);
+        }
+
+        void put(Value&& val,Key&& key)
+        {
+            Shard& shard=shardFor(key);
+            shard.lru.put(std::move(val),std::move(key));
+        }
+
+        void put(const Value& val,const Key& key,const std::chrono::milliseconds ttl)
+        {
+            shardFor(key).lru.put(val,key,ttl);
+        }
+
+        void put(Value&& val,const Key& key,const std::chrono::milliseconds ttl)
+        {
+            shardFor(key).lru.put(std::move(val),key,ttl);
+        }
+
+        template<typename... Args>
+        bool tryEmplace(const Key& key,Args&&... args)
+        {
+            return shardFor(key).lru.tryEmplace(key,std::forward<Args>(args)...);
+        }
+
+        /*
+        批量读写：先按分片把下标分组，每个分片只加一次锁
+        分组后只把下标交给分片，分片直接读写调用方的keys/values，value不经过中间数组
+        */
+        std::vector<bool> getMany(std::span<const Key> keys,std::span<Value> values) override
+        {
+            const std::size_t count=std::min(keys.size(),values.size());
+            std::vector<bool> hits(count);
+            const BatchPlan& plan=planBatch(keys.first(count));
+            for (std::size_t s=0;s<N;s++)
+            {
+                const auto positions=plan.positionsOf(s);
+                if (positions.empty()) continue;
+                shards[s].lru.getManyAt(keys,values,positions,hits);
+            }
+            return hits;
+        }
+
+        void putMany(std::span<const Value> values,std::span<const Key> keys) override
+        {
+            const std::size_t count=std::min(keys.size(),values.size());
+            const BatchPlan& plan=planBatch(keys.first(count));
+            for (std::size_t s=0;s<N;s++)
+            {
+                const auto positions=plan.positionsOf(s);
+                if (positions.empty()) continue;
+                shards[s].lru.putManyAt(values,keys,positions);
+            }
+        }
+
+        AlgorithmStandard::ValueHandle<Value> getHandle(const Key& key) override
+        {
+            return shardFor(key).lru.getHandle(key);
+        }
+
+        // 按同样的切分方式把新容量分给每个分片，各分片依次加自己的锁调整
+        void resize(const std::size_t newCapacity)
+        {
+            for (std::size_t i=0;i<N;i++)
+            {
+                shards[i].lru.resize(sliceOf(newCapacity,i));
+            }
+        }
+
+        std::size_t getCapacity()
+        {
+            std::size_t total=0;
+            for (auto& shard : shards)
+            {
+                total+=shard.lru.getCapacity();
+            }
+            return total;
+        }
+
+        std::size_t getTotalWeight()
+        {
+            std::size_t total=0;
+            for (auto& shard : shards)
+            {
+                total+=shard.lru.getTotalWeight();
+            }
+            return total;
+        }
+
+        // 所有计数都发生在分片里，把各分片的快照加起来
+        AlgorithmStandard::CacheStats stats() const override
+        {
+            AlgorithmStandard::CacheStats total;
+            for (const auto& shard : shards)
+            {
+                total+=shard.lru.stats();
+            }
+            return total;
+        }
+
+        AlgorithmStandard::LatencyReport latencies() const override
+        {
+            AlgorithmStandard::LatencyReport total;
+            for (const auto& shard : shards)
+            {
+                total+=shard.lru.latencies();
+            }
+            return total;
+        }
+    };
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace AlgorithmStandard
+{
+    // 正在加载的key按哈希分到这么多张表里，每张表有自己的锁，不同key的未命中不会都挤在同一把锁上
+    inline constexpr std::size_t FLIGHT_STRIPES=16;
+
+    // 和ShardedLRU一样先乘一个奇数常量打散，再取最高4位（分片用的是中间的位，两者错开）
+    template<typename Key>
+    std::size_t flightStripe(const Key& key)
+    {
+        static_assert(FLIGHT_STRIPES==16,"取最高4位对应16张表");
+        const std::uint64_t h=static_cast<std::uint64_t>(std::hash<Key>{}(key))*0x9E3779B97F4A7C15ULL;
+        return static_cast<std::size_t>(h>>60);
+    }
+
+    /*
+    合并同一个key的并发加载：同一时刻每个key最多只有一个调用者（leader）真正执行load，
+    其他调用者拿到leader登记的shared_future等待同一个结果
+    只有登记/查找的那一小段持有key所在那张表的锁，load本身在锁外执行
+    load抛出的异常会传给所有等待者，失败的结果不会留下，下一次调用重新加载
+    */
+    template<typename Key,typename Value>
+    class SingleFlight
+    {
+        struct alignas(64) Stripe
+        {
+            std::mutex mutex;
+            std::unordered_map<Key,std::shared_future<Value>> flights;
+        };
+
+        std::array<Stripe,FLIGHT_STRIPES> stripes;
+
+        static void finish(Stripe& stripe,const Key& key)
+        {
+            std::lock_guard lock(stripe.mutex);
+            stripe.flights.erase(key);
+        }
+
+    public:
+        template<typename Load>
+        Value run(const Key& key,Load&& load)
+        {
+            Stripe& stripe=stripes[flightStripe(key)];
+            std::promise<Value> promise;
+            {
+                std::unique_lock lock(stripe.mutex);
+                auto iter=stripe.flights.find(key);
+                if (iter!=stripe.flights.end())
+                {
+                    std::shared_future<Value> future=iter->second;
+                    lock.unlock();
+                    return future.get();
+                }
+                stripe.flights.emplace(key,promise.get_future().share());
+            }
+            try
+            {
+                Value value=std::forward<Load>(load)();
+                promise.set_value(value);
+                finish(stripe,key);
+                return value;
+            }
+            catch (...)
+            {
+                promise.set_exception(std::current_exception());
+                finish(stripe,key);
+                throw;
+            }
+        }
+    };
+}
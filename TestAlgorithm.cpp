@@ -3,14 +3,48 @@
 #include <iomanip>
 #include <climits>
 #include <random>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
 #include "LRUAlgorithm.h"
 #include "AlgorithmStandard.h"
 #include "LFUAlgorithm.h"
+#include "BucketLFUAlgorithm.h"
+#include "ARCAlgorithm.h"
+#include "WTinyLFUAlgorithm.h"
+#include "ClockAlgorithm.h"
+#include "LRUKAlgorithm.h"
+#include "TwoQAlgorithm.h"
+#include "S3FIFOAlgorithm.h"
+#include "ShardedLRUAlgorithm.h"
+#include "PolicyCache.h"
 
 namespace TEST
 {
     void printResult(int operations,int hits, const std::string& description);
 
+    // 不一致的检查项个数，main据此决定退出码
+    inline int FailedChecks=0;
+
+    // 功能测试用：期望值和实际值一起输出，不一致时在行尾标出来并计数
+    template<typename T>
+    void printCheck(const std::string& description,const T& expected,const T& actual)
+    {
+        if (expected!=actual)
+        {
+            FailedChecks++;
+        }
+        std::cout<<std::boolalpha<<description<<": 期望 "<<expected<<"，实际 "<<actual
+                 <<(expected==actual?"":"  <-- 不一致")<<std::noboolalpha<<std::endl;
+    }
+
     class Timer
     {
         std::chrono::high_resolution_clock::time_point start;
@@ -28,14 +62,36 @@ namespace TEST
         }
     };
 
+    // 参与对比的一个算法实例：通过统一接口调用，命中数分别统计
+    struct TestedAlgorithm
+    {
+        std::string description;
+        AlgorithmStandard::Algorithmstandard<int,std::string>& algorithm;
+        int hits;
+    };
+
     void TestAlgorithm()
     {
         LRU::LRUAlgorithm<int,std::string> lru;
         LFU::LFUAlgorithm<int,std::string> lfuNoReduction(INT_MAX);
         LFU::LFUAlgorithm<int,std::string> lfuWithReduction(100); // 假设最大阈值来触发衰减
-        int hits_LRU=0;
-        int hits_LFU=0;
-        int hits_LFU_AGING=0;
+        ARC::ARCAlgorithm<int,std::string> arc;
+        Clock::ClockAlgorithm<int,std::string> clockAlgorithm;
+        Clock::SieveAlgorithm<int,std::string> sieve;
+        LRU::LRUKAlgorithm<int,std::string> lruK;
+        TwoQ::TwoQAlgorithm<int,std::string> twoQ;
+        S3FIFO::S3FIFOAlgorithm<int,std::string> s3fifo;
+        std::vector<TestedAlgorithm> algorithms{
+            {"",lru,0},
+            {"LFU无衰减",lfuNoReduction,0},
+            {"LFU有衰减",lfuWithReduction,0},
+            {"ARC",arc,0},
+            {"CLOCK",clockAlgorithm,0},
+            {"SIEVE",sieve,0},
+            {"LRU-2",lruK,0},
+            {"2Q",twoQ,0},
+            {"S3-FIFO",s3fifo,0},
+        };
         int operations=0;
         std::random_device seed;
         // 需要随机种子，每次调用seed生成一个随机数，seed是实例名
@@ -50,9 +106,10 @@ namespace TEST
         for (int i=0;i<HOTKEY;i++)
         {
             std::string ToBeValue = "value" + std::to_string(i);
-            lru.put(ToBeValue,i);
-            lfuNoReduction.put(ToBeValue,i);
-            lfuWithReduction.put(ToBeValue,i);
+            for (auto& tested : algorithms)
+            {
+                tested.algorithm.put(ToBeValue,i);
+            }
         }
 
 
@@ -62,93 +119,774 @@ namespace TEST
         {
             if (GetOrPut(rng)<=3)
             {
-                if (HotOrCold(rng)<=3)
+                // 注意格式一致，先写上value
+                const int CurrentKey = HotOrCold(rng)<=3 ? ColdKeyGen(rng) : HotKeyGen(rng);
+                for (auto& tested : algorithms)
                 {
-                    int CurrentKey = ColdKeyGen(rng);
-                    lru.put("value"+std::to_string(CurrentKey),CurrentKey);
-                    lfuNoReduction.put("value"+std::to_string(CurrentKey),CurrentKey);
-                    lfuWithReduction.put("value"+std::to_string(CurrentKey),CurrentKey);
-                    // 注意格式一致，先写上value
-                }
-                else
-                {
-                    int CurrentKey = HotKeyGen(rng);
-                    lru.put("value"+std::to_string(CurrentKey),CurrentKey);
-                    lfuNoReduction.put("value"+std::to_string(CurrentKey),CurrentKey);
-                    lfuWithReduction.put("value"+std::to_string(CurrentKey),CurrentKey);
+                    tested.algorithm.put("value"+std::to_string(CurrentKey),CurrentKey);
                 }
             }
             else
             {
                 operations++;
-                if (HotOrCold(rng)<=3)
+                const int CurrentKey = HotOrCold(rng)<=3 ? ColdKeyGen(rng) : HotKeyGen(rng);
+                std::string retrived_value;
+                // C++允许传入空的函数参数，get通过修改对应指针的值返回value
+                for (auto& tested : algorithms)
                 {
-                    int CurrentKey = ColdKeyGen(rng);
-                    std::string retrived_value;
-                    // C++允许传入空的函数参数，get通过修改对应指针的值返回value
-                    if (lru.get(CurrentKey,retrived_value)==true)
+                    if (tested.algorithm.get(CurrentKey,retrived_value)==true)
                     {
-                        hits_LRU++;
+                        tested.hits++;
                         // 缓存返回值正确性检查
                         if (retrived_value!="value"+std::to_string(CurrentKey))
                         {
-                            std::cout<<"使用get方法时读取错误在"<<retrived_value<<std::endl;
-                        }
-                    }
-                    if (lfuNoReduction.get(CurrentKey,retrived_value)==true)
-                    {
-                        hits_LFU++;
-                        // 缓存返回值正确性检查
-                        if (retrived_value!="value"+std::to_string(CurrentKey))
-                        {
-                            std::cout<<"LFU无衰减使用get方法时读取错误在"<<retrived_value<<std::endl;
-                        }
-                    }
-                    if (lfuWithReduction.get(CurrentKey,retrived_value)==true)
-                    {
-                        hits_LFU_AGING++;
-                        // 缓存返回值正确性检查
-                        if (retrived_value!="value"+std::to_string(CurrentKey))
-                        {
-                            std::cout<<"LFU有衰减使用get方法时读取错误在"<<retrived_value<<std::endl;
+                            std::cout<<tested.description<<"使用get方法时读取错误在"<<retrived_value<<std::endl;
                         }
                     }
                 }
-                else
+            }
+        }
+        for (const auto& tested : algorithms)
+        {
+            printResult(operations,tested.hits,tested.description);
+        }
+        std::cout<<"\n总用时: "<<t.TimerEnd().count()<<"ms"<<std::endl;
+#ifdef CACHE_LATENCY_HISTOGRAM
+        // 总用时看不出尾延迟，启用直方图时再输出每个算法内部的延迟分布（纳秒）
+        for (const auto& tested : algorithms)
+        {
+            std::cout<<"\n"<<(tested.description.empty()?"LRU":tested.description)<<" 延迟分布:"<<std::endl;
+            tested.algorithm.latencies().print(std::cout);
+        }
+#endif
+    }
+
+    /*
+    LFU老化延迟测试：容量较大、阈值较低时会频繁触发老化
+    逐次记录每个get/put的耗时，关心的是尾延迟（p99.9/最大值），而不是总用时
+    */
+    void TestAgingLatency()
+    {
+        constexpr int AGING_CAPACITY=50000;
+        constexpr int AGING_THRESHOLD=2;
+        LFU::LFUAlgorithm<int,int> lfu(AGING_THRESHOLD,AGING_CAPACITY);
+        std::mt19937 rng(42);
+        std::uniform_int_distribution GetOrPut(1,10);
+        std::uniform_int_distribution KeyGen(0,AGING_CAPACITY-1);
+        for (int i=0;i<AGING_CAPACITY;i++)
+        {
+            lfu.put(i,i);
+        }
+
+        // key提前生成好，测量区间内只有缓存操作本身
+        std::vector<int> keys(OPERATIONS);
+        std::vector<bool> isGet(OPERATIONS);
+        for (int i=0;i<OPERATIONS;i++)
+        {
+            keys[i]=KeyGen(rng);
+            isGet[i]=GetOrPut(rng)>3;
+        }
+        std::vector<long long> latencies(OPERATIONS);
+        int value=0;
+        for (int i=0;i<OPERATIONS;i++)
+        {
+            const auto start=std::chrono::steady_clock::now();
+            if (isGet[i]) lfu.get(keys[i],value);
+            else lfu.put(keys[i],keys[i]);
+            latencies[i]=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-start).count();
+        }
+        std::sort(latencies.begin(),latencies.end());
+        auto percentile=[&latencies](const double p)
+        {
+            return latencies[static_cast<std::size_t>(p*static_cast<double>(latencies.size()-1))];
+        };
+        std::cout<<"\nLFU老化延迟测试（容量"<<AGING_CAPACITY<<"，阈值"<<AGING_THRESHOLD<<"）:"<<std::endl;
+        std::cout<<"p50: "<<percentile(0.5)<<"ns  p99: "<<percentile(0.99)<<"ns  p99.9: "<<percentile(0.999)
+                 <<"ns  p99.99: "<<percentile(0.9999)<<"ns  最大: "<<latencies.back()<<"ns"<<std::endl;
+        // 最大值里包含线程被调度出去的时间，每次运行差别很大，要结合老化次数和下面的直方图看
+        std::cout<<"老化次数: "<<lfu.stats().agingPasses<<std::endl;
+#ifdef CACHE_LATENCY_HISTOGRAM
+        // 引擎内部的直方图把老化单独列出来，可以看到尾延迟里有多少来自ReduceAllNodeFrequency
+        lfu.latencies().print(std::cout);
+#endif
+    }
+
+    /*
+    扫描抗性测试：热点访问中间穿插一次顺序扫描（模拟夜间批处理）
+    每一轮先做SCAN_HOT_OPERATIONS次访问（80%落在热点数据上），再顺序扫描SCAN_LENGTH个从没出现过的key
+    未命中时像真实业务一样回填；只统计热点访问阶段的命中率，看扫描之后热点数据还剩多少
+    */
+    void TestScanResistance()
+    {
+        constexpr int SCAN_CAPACITY=1000;
+        constexpr int SCAN_HOTKEYS=800;
+        constexpr int SCAN_LENGTH=10*SCAN_CAPACITY;
+        constexpr int SCAN_ROUNDS=20;
+        constexpr int SCAN_HOT_OPERATIONS=20000;
+        LRU::LRUAlgorithm<int,int> lru(SCAN_CAPACITY);
+        LRU::LRUKAlgorithm<int,int> lruK(SCAN_CAPACITY);
+        TwoQ::TwoQAlgorithm<int,int> twoQ(SCAN_CAPACITY);
+        ARC::ARCAlgorithm<int,int> arc(SCAN_CAPACITY);
+        Clock::SieveAlgorithm<int,int> sieve(SCAN_CAPACITY);
+        S3FIFO::S3FIFOAlgorithm<int,int> s3fifo(SCAN_CAPACITY);
+        struct ScanTested
+        {
+            std::string description;
+            AlgorithmStandard::Algorithmstandard<int,int>& algorithm;
+            int hits;
+        };
+        std::vector<ScanTested> algorithms{
+            {"LRU",lru,0},
+            {"LRU-2",lruK,0},
+            {"2Q",twoQ,0},
+            {"ARC",arc,0},
+            {"SIEVE",sieve,0},
+            {"S3-FIFO",s3fifo,0},
+        };
+        std::mt19937 rng(42);
+        std::uniform_int_distribution HotOrCold(1,10);
+        std::uniform_int_distribution HotKeyGen(0,SCAN_HOTKEYS-1);
+        std::uniform_int_distribution ColdKeyGen(SCAN_HOTKEYS,SCAN_HOTKEYS+COLDKEYS-1);
+        int operations=0;
+        int ScanKey=INT_MAX/2;
+        // 扫描用的key从一个不会和热点、冷数据重叠的区间开始递增
+        for (int round=0;round<SCAN_ROUNDS;round++)
+        {
+            for (int i=0;i<SCAN_HOT_OPERATIONS;i++)
+            {
+                operations++;
+                const int CurrentKey=HotOrCold(rng)<=8?HotKeyGen(rng):ColdKeyGen(rng);
+                for (auto& tested : algorithms)
                 {
-                    int CurrentKey = HotKeyGen(rng);
-                    std::string retrived_value;
-                    if (lru.get(CurrentKey,retrived_value)==true)
-                    {
-                        hits_LRU++;
-                        if (retrived_value!="value"+std::to_string(CurrentKey))
-                        {
-                            std::cout<<"使用get方法时读取错误在"<<retrived_value<<std::endl;
-                        }
-                    }
-                    if (lfuNoReduction.get(CurrentKey,retrived_value)==true)
-                    {
-                        hits_LFU++;
-                        if (retrived_value!="value"+std::to_string(CurrentKey))
-                        {
-                            std::cout<<"LFU无衰减使用get方法时读取错误在"<<retrived_value<<std::endl;
-                        }
-                    }
-                    if (lfuWithReduction.get(CurrentKey,retrived_value)==true)
-                    {
-                        hits_LFU_AGING++;
-                        if (retrived_value!="value"+std::to_string(CurrentKey))
-                        {
-                            std::cout<<"LFU有衰减使用get方法时读取错误在"<<retrived_value<<std::endl;
-                        }
-                    }
+                    int value=0;
+                    if (tested.algorithm.get(CurrentKey,value)) tested.hits++;
+                    else tested.algorithm.put(CurrentKey,CurrentKey);
+                }
+            }
+            for (int i=0;i<SCAN_LENGTH;i++,ScanKey++)
+            {
+                for (auto& tested : algorithms)
+                {
+                    int value=0;
+                    if (!tested.algorithm.get(ScanKey,value)) tested.algorithm.put(ScanKey,ScanKey);
                 }
             }
         }
-        printResult(operations,hits_LRU,"");
-        printResult(operations,hits_LFU,"LFU无衰减");
-        printResult(operations,hits_LFU_AGING,"LFU有衰减");
-        std::cout<<"\n总用时: "<<t.TimerEnd().count()<<"ms"<<std::endl;
+        std::cout<<"\n扫描抗性测试（容量"<<SCAN_CAPACITY<<"，每轮扫描"<<SCAN_LENGTH<<"个key）:"<<std::endl;
+        for (const auto& tested : algorithms)
+        {
+            printResult(operations,tested.hits,tested.description);
+        }
+    }
+
+    /*
+    容量测试：运行时resize缩容、扩容之后条目数和淘汰顺序是否正确
+    再填满一个两百万条目的LFU并析构：同一条频率链表上的节点很多，析构时不能逐层递归释放
+    */
+    void TestCapacity()
+    {
+        std::cout<<"\n容量测试:"<<std::endl;
+        LRU::LRUAlgorithm<int,int> lru(10);
+        LFU::LFUAlgorithm<int,int> lfu(INT_MAX,10);
+        int value=0;
+        for (int i=0;i<10;i++)
+        {
+            lru.put(i,i);
+            lfu.put(i,i);
+        }
+        // LFU里key 5~9多访问一次，缩容时应该留下它们
+        for (int i=5;i<10;i++)
+        {
+            lfu.get(i,value);
+        }
+        lru.resize(5);
+        lfu.resize(5);
+        printCheck("LRU缩容到5后的条目数",std::size_t{5},lru.getTotalWeight());
+        printCheck("LRU缩容后最早插入的key 0",false,lru.get(0,value));
+        printCheck("LRU缩容后最后插入的key 9",true,lru.get(9,value));
+        printCheck("LFU缩容到5后的条目数",std::size_t{5},lfu.getTotalWeight());
+        printCheck("LFU缩容后低频的key 0",false,lfu.get(0,value));
+        printCheck("LFU缩容后高频的key 5",true,lfu.get(5,value));
+        lru.resize(20);
+        lfu.resize(20);
+        for (int i=100;i<120;i++)
+        {
+            lru.put(i,i);
+            lfu.put(i,i);
+        }
+        printCheck("LRU扩容到20再插入20个key后的条目数",std::size_t{20},lru.getTotalWeight());
+        printCheck("LFU扩容到20再插入20个key后的条目数",std::size_t{20},lfu.getTotalWeight());
+
+        constexpr int LARGE_CAPACITY=2000000;
+        Timer t;
+        t.TimerStart();
+        {
+            auto large=std::make_unique<LFU::LFUAlgorithm<int,int>>(INT_MAX,LARGE_CAPACITY);
+            for (int i=0;i<LARGE_CAPACITY;i++)
+            {
+                large->put(i,i);
+            }
+            printCheck("两百万条目LFU填满后的条目数",static_cast<std::size_t>(LARGE_CAPACITY),large->getTotalWeight());
+        }
+        std::cout<<"两百万条目LFU填满并析构用时: "<<t.TimerEnd().count()<<"ms"<<std::endl;
+    }
+
+    /*
+    只读句柄测试：句柄内容正确；key被覆盖之后已经拿到的句柄仍然看到旧值
+    SharedValues=true的LRU和LFU两次命中拿到的是同一个对象（零拷贝），默认的LRU和LFU每次拷贝出一个新对象
+    */
+    void TestHandle()
+    {
+        std::cout<<"\n只读句柄测试:"<<std::endl;
+        LRU::LRUAlgorithm<int,std::string> lru(10);
+        LRU::SharedLRUAlgorithm<int,std::string> sharedLru(10);
+        LFU::LFUAlgorithm<int,std::string> lfu(INT_MAX,10);
+        LFU::SharedLFUAlgorithm<int,std::string> sharedLfu(INT_MAX,10);
+        struct HandleTested
+        {
+            std::string description;
+            AlgorithmStandard::Algorithmstandard<int,std::string>& algorithm;
+            bool zeroCopy;
+        };
+        std::vector<HandleTested> algorithms{
+            {"LRU",lru,false},
+            {"LRU(SharedValues)",sharedLru,true},
+            {"LFU",lfu,false},
+            {"LFU(SharedValues)",sharedLfu,true},
+        };
+        for (auto& tested : algorithms)
+        {
+            tested.algorithm.put("old",1);
+            const auto first=tested.algorithm.getHandle(1);
+            const auto second=tested.algorithm.getHandle(1);
+            printCheck(tested.description+" 句柄内容",std::string("old"),first==nullptr?std::string():*first);
+            printCheck(tested.description+" 两次命中共享同一个对象",tested.zeroCopy,first.get()==second.get());
+            tested.algorithm.put("new",1);
+            const auto third=tested.algorithm.getHandle(1);
+            printCheck(tested.description+" 覆盖后旧句柄的内容",std::string("old"),*first);
+            printCheck(tested.description+" 覆盖后新句柄的内容",std::string("new"),third==nullptr?std::string():*third);
+            printCheck(tested.description+" 未命中返回空句柄",true,tested.algorithm.getHandle(2)==nullptr);
+        }
+    }
+
+    // 构造或拷贝时可以按要求抛出异常的value，用来检查插入中途抛出异常后索引里不会留下占位
+    struct FragileValue
+    {
+        int number=0;
+        bool throwOnCopy=false;
+
+        FragileValue()=default;
+        FragileValue(const int number,const bool throwOnConstruct,const bool throwOnCopy=false):number(number),throwOnCopy(throwOnCopy)
+        {
+            if (throwOnConstruct) throw std::runtime_error("FragileValue构造失败");
+        }
+        FragileValue(const FragileValue& other):number(other.number),throwOnCopy(other.throwOnCopy)
+        {
+            if (throwOnCopy) throw std::runtime_error("FragileValue拷贝失败");
+        }
+        FragileValue& operator=(const FragileValue&)=default;
+    };
+
+    template<typename Cache>
+    void checkInsertFailure(const std::string& description,Cache& cache)
+    {
+        bool thrown=false;
+        try
+        {
+            cache.tryEmplace(7,7,true);
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown=true;
+        }
+        FragileValue value;
+        printCheck(description+" tryEmplace构造value时抛出异常",true,thrown);
+        printCheck(description+" 抛出异常后key 7不存在",false,cache.get(7,value));
+        thrown=false;
+        try
+        {
+            const FragileValue fragile(8,false,true);
+            cache.put(fragile,8);
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown=true;
+        }
+        printCheck(description+" put拷贝value时抛出异常",true,thrown);
+        printCheck(description+" 抛出异常后key 8不存在",false,cache.get(8,value));
+        printCheck(description+" 之后tryEmplace(7)正常插入",true,cache.tryEmplace(7,70,false));
+        printCheck(description+" key已存在时tryEmplace不覆盖",false,cache.tryEmplace(7,71,false));
+        cache.get(7,value);
+        printCheck(description+" key 7的value",70,value.number);
+        printCheck(description+" 条目数",std::size_t{1},cache.getTotalWeight());
+    }
+
+    /*
+    没有tryEmplace的缓存只检查put拷贝value抛出异常的情况：没满时插入、满了要淘汰时各一次
+    cache的容量必须是2，插入失败后原有的条目都要还在
+    */
+    template<typename Cache>
+    void checkPutFailure(const std::string& description,Cache& cache)
+    {
+        FragileValue value;
+        const FragileValue fragile(8,false,true);
+        bool thrown=false;
+        try
+        {
+            cache.put(fragile,8);
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown=true;
+        }
+        printCheck(description+" 没满时拷贝value抛出异常",true,thrown);
+        printCheck(description+" 抛出异常后key 8不存在",false,cache.get(8,value));
+        cache.put(FragileValue(1,false),1);
+        cache.put(FragileValue(2,false),2);
+        thrown=false;
+        try
+        {
+            cache.put(fragile,9);
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown=true;
+        }
+        printCheck(description+" 满了要淘汰时拷贝value抛出异常",true,thrown);
+        printCheck(description+" 抛出异常后key 9不存在",false,cache.get(9,value));
+        int survivors=0;
+        for (int key=1;key<=2;key++)
+        {
+            if (cache.get(key,value) && value.number==key) survivors++;
+        }
+        printCheck(description+" 原有的条目都还在",2,survivors);
+    }
+
+    /*
+    插入的异常安全和原地构造：value的构造或拷贝抛出异常后，缓存里不能留下指向不存在节点的key
+    再检查key是右值的put：插入新key时key被移动进缓存，之后可以正常查到
+    */
+    void TestInsert()
+    {
+        std::cout<<"\n插入测试:"<<std::endl;
+        LRU::LRUAlgorithm<int,FragileValue> lru(10);
+        LRU::SharedLRUAlgorithm<int,FragileValue> sharedLru(10);
+        LFU::LFUAlgorithm<int,FragileValue> lfu(INT_MAX,10);
+        checkInsertFailure("LRU",lru);
+        checkInsertFailure("LRU(SharedValues)",sharedLru);
+        checkInsertFailure("LFU",lfu);
+        LFU::SharedLFUAlgorithm<int,FragileValue> sharedLfu(INT_MAX,10);
+        checkInsertFailure("LFU(SharedValues)",sharedLfu);
+        Policy::Cache<Policy::LRUPolicy,int,FragileValue> policyLru(2);
+        Policy::Cache<Policy::LRUPolicy,int,FragileValue,std::hash<int>,std::mutex,AlgorithmStandard::StatsCounter,Policy::FlatSlotIndex> flatPolicyLru(2);
+        Clock::ClockAlgorithm<int,FragileValue> clock(2);
+        Clock::SieveAlgorithm<int,FragileValue> sieve(2);
+        checkPutFailure("PolicyLRU",policyLru);
+        checkPutFailure("PolicyLRU(FlatSlotIndex)",flatPolicyLru);
+        checkPutFailure("CLOCK",clock);
+        checkPutFailure("SIEVE",sieve);
+        // LRU-K的新节点里先放一个默认构造的Value，put的value在节点建好之后才赋值，FragileValue触发不了占位期间的异常，这里只检查2Q
+        TwoQ::TwoQAlgorithm<int,FragileValue> twoQ(2);
+        checkPutFailure("2Q",twoQ);
+        S3FIFO::S3FIFOAlgorithm<int,FragileValue> s3fifo(2);
+        checkPutFailure("S3-FIFO",s3fifo);
+        LFU::BucketLFUAlgorithm<int,FragileValue> bucketLfu(2);
+        checkPutFailure("BucketLFU",bucketLfu);
+        ARC::ARCAlgorithm<int,FragileValue> arc(2);
+        checkPutFailure("ARC",arc);
+        TinyLFU::WTinyLFUAlgorithm<int,FragileValue> tinyLfu(2);
+        checkPutFailure("W-TinyLFU",tinyLfu);
+
+        LRU::LRUAlgorithm<std::string,std::string> stringLru(10);
+        LFU::LFUAlgorithm<std::string,std::string> stringLfu(INT_MAX,10);
+        const std::string LongKey(64,'k');
+        std::string value;
+        stringLru.put(std::string("value"),std::string(LongKey));
+        stringLfu.put(std::string("value"),std::string(LongKey));
+        printCheck("LRU 右值key写入后可以查到",true,stringLru.get(LongKey,value) && value=="value");
+        printCheck("LFU 右值key写入后可以查到",true,stringLfu.get(LongKey,value) && value=="value");
+    }
+
+    /*
+    扁平索引测试：reserve(n)之后反复插入、删除，元素个数始终不超过n，和缓存稳定运行时的put/淘汰一样
+    期间一直留在表里的key地址不变，说明既没有扩容也没有原地重建；结果和std::unordered_map逐次对比
+    */
+    void TestFlatIndex()
+    {
+        std::cout<<"\n扁平索引测试:"<<std::endl;
+        constexpr int LIVE=1000;
+        constexpr int ROUNDS=2000000;
+        AlgorithmStandard::FlatIndex<int,int> index;
+        std::unordered_map<int,int> expected;
+        index.reserve(LIVE+1);
+        const auto* pinned=&*index.try_emplace(-1,-1).first;
+        std::mt19937 gen(7);
+        std::vector<int> liveKeys;
+        int next=0;
+        int mismatches=0;
+        for (int round=0;round<ROUNDS;round++)
+        {
+            index.try_emplace(next,next);
+            expected.emplace(next,next);
+            liveKeys.push_back(next);
+            next++;
+            if (static_cast<int>(liveKeys.size())>LIVE)
+            {
+                // 随机删掉一个旧key，删除位置分散在整张表里
+                const std::size_t victim=gen()%liveKeys.size();
+                std::swap(liveKeys[victim],liveKeys.back());
+                if (index.erase(liveKeys.back())!=expected.erase(liveKeys.back())) mismatches++;
+                liveKeys.pop_back();
+            }
+            const int probe=static_cast<int>(gen()%static_cast<unsigned>(next));
+            const auto iter=index.find(probe);
+            const auto want=expected.find(probe);
+            if ((iter==index.end())!=(want==expected.end())) mismatches++;
+        }
+        printCheck("FlatIndex 查找、删除结果和unordered_map不同的次数",0,mismatches);
+        printCheck("FlatIndex 元素个数",expected.size()+1,index.size());
+        printCheck("FlatIndex 一直留在表里的key地址不变",true,&*index.find(-1)==pinned);
+    }
+
+    /*
+    批量读写测试：putMany写入一批key，getMany读回来（中间夹着不存在的key），检查命中位图、value和统计
+    ShardedLRU会把一批key分到不同分片，结果要放回原来的位置
+    */
+    void TestBatch()
+    {
+        std::cout<<"\n批量读写测试:"<<std::endl;
+        LRU::LRUAlgorithm<int,std::string> lru(100);
+        LFU::LFUAlgorithm<int,std::string> lfu(INT_MAX,100);
+        LRU::ShardedLRU<int,std::string,4> sharded(100);
+        std::vector<TestedAlgorithm> algorithms{
+            {"LRU",lru,0},
+            {"LFU",lfu,0},
+            {"ShardedLRU",sharded,0},
+        };
+        constexpr int BATCH=50;
+        std::vector<int> keys(BATCH);
+        std::vector<std::string> values(BATCH);
+        for (int i=0;i<BATCH;i++)
+        {
+            keys[i]=i;
+            values[i]="value"+std::to_string(i);
+        }
+        // 偶数位置是写入过的key，奇数位置是不存在的key
+        std::vector<int> queries(2*BATCH);
+        for (int i=0;i<BATCH;i++)
+        {
+            queries[2*i]=BATCH-1-i;
+            queries[2*i+1]=1000+i;
+        }
+        for (auto& tested : algorithms)
+        {
+            tested.algorithm.putMany(values,keys);
+            std::vector<std::string> results(queries.size());
+            const std::vector<bool> hits=tested.algorithm.getMany(queries,results);
+            int correct=0;
+            for (std::size_t i=0;i<queries.size();i++)
+            {
+                if (hits[i]) tested.hits++;
+                const bool expected=i%2==0;
+                if (hits[i]==expected && (!expected || results[i]=="value"+std::to_string(queries[i]))) correct++;
+            }
+            const AlgorithmStandard::CacheStats stats=tested.algorithm.stats();
+            printCheck(tested.description+" 命中数",BATCH,tested.hits);
+            printCheck(tested.description+" 位置和value都正确的结果数",2*BATCH,correct);
+            printCheck(tested.description+" 统计的写入次数",static_cast<std::uint64_t>(BATCH),stats.puts);
+            printCheck(tested.description+" 统计的未命中次数",static_cast<std::uint64_t>(BATCH),stats.misses);
+        }
+    }
+
+    /*
+    权重测试：权重函数返回value的长度，容量是长度总和的上限
+    插入大条目、覆盖成更大的value、缩容时都要淘汰其他条目，单个条目超过上限时不插入
+    */
+    template<typename Cache>
+    void checkWeigher(const std::string& description,Cache& cache)
+    {
+        constexpr std::size_t LIMIT=100;
+        for (int i=0;i<10;i++)
+        {
+            cache.put(std::string(10,'a'),i);
+        }
+        printCheck(description+" 写满后的总权重",LIMIT,cache.getTotalWeight());
+        cache.put(std::string(30,'b'),10);
+        std::string value;
+        printCheck(description+" 插入大条目后可以查到",true,cache.get(10,value) && value.size()==30);
+        printCheck(description+" 插入大条目后的总权重",LIMIT,cache.getTotalWeight());
+        cache.put(std::string(LIMIT+1,'c'),11);
+        printCheck(description+" 超过上限的条目不插入",false,cache.get(11,value));
+        printCheck(description+" 拒绝插入后总权重不变",LIMIT,cache.getTotalWeight());
+        cache.put(std::string(60,'d'),10);
+        printCheck(description+" 覆盖成更大的value后可以查到",true,cache.get(10,value) && value.size()==60);
+        printCheck(description+" 覆盖后的总权重",LIMIT,cache.getTotalWeight());
+        int present=0;
+        for (int i=0;i<10;i++)
+        {
+            if (cache.get(i,value)) present++;
+        }
+        printCheck(description+" 剩下的小条目数",4,present);
+        cache.resize(LIMIT/2);
+        printCheck(description+" 缩容后总权重不超过上限",true,cache.getTotalWeight()<=LIMIT/2);
+    }
+
+    void TestWeigher()
+    {
+        std::cout<<"\n权重测试:"<<std::endl;
+        const AlgorithmStandard::Weigher<int,std::string> weigher=[](const int&,const std::string& value)
+        {
+            return value.size();
+        };
+        LRU::LRUAlgorithm<int,std::string> lru(100,weigher);
+        LFU::LFUAlgorithm<int,std::string> lfu(INT_MAX,100,weigher);
+        checkWeigher("LRU",lru);
+        checkWeigher("LFU",lfu);
+
+        // 分片按权重切分上限，每个分片各自淘汰，总权重不超过构造时的上限
+        LRU::ShardedLRU<int,std::string,4> sharded(100,weigher);
+        for (int i=0;i<1000;i++)
+        {
+            sharded.put(std::string(static_cast<std::size_t>(i%20+1),'s'),i);
+        }
+        printCheck("ShardedLRU 大量写入后总权重不超过上限",true,sharded.getTotalWeight()<=100);
+        printCheck("ShardedLRU 总容量",std::size_t{100},sharded.getCapacity());
+    }
+
+    /*
+    TTL测试：时间轮到点后主动回收条目；ttl为0的条目立即过期；再次写入会取消原来的TTL
+    覆盖和淘汰都要把时间轮里的条目删掉，时间轮里的条目数不能超过缓存里带TTL的条目数
+    */
+    template<typename Cache>
+    void checkTTL(const std::string& description,Cache& cache)
+    {
+        using namespace std::chrono_literals;
+        constexpr int CAPACITY=10;
+        int value=0;
+        for (int i=0;i<CAPACITY;i++)
+        {
+            cache.put(i,i,1ms);
+        }
+        std::this_thread::sleep_for(20ms);
+        cache.get(-1,value);
+        printCheck(description+" 到点后回收的条目数",static_cast<std::uint64_t>(CAPACITY),cache.stats().expirations);
+        printCheck(description+" 回收后时间轮为空",std::size_t{0},cache.getPendingTimers());
+        printCheck(description+" 回收后的总权重",std::size_t{0},cache.getTotalWeight());
+        cache.put(1,1,0ms);
+        printCheck(description+" ttl为0的条目立即过期",false,cache.get(1,value));
+        cache.put(2,2,0ms);
+        cache.put(2,2);
+        printCheck(description+" 不带TTL覆盖后不过期",true,cache.get(2,value));
+        printCheck(description+" 不带TTL覆盖后时间轮为空",std::size_t{0},cache.getPendingTimers());
+        cache.put(3,3,0ms);
+        cache.put(3,3,1h);
+        printCheck(description+" 用更长的TTL覆盖后不过期",true,cache.get(3,value));
+        printCheck(description+" 覆盖后时间轮只有一个条目",std::size_t{1},cache.getPendingTimers());
+        for (int i=0;i<100*CAPACITY;i++)
+        {
+            cache.put(i,i,1h);
+        }
+        printCheck(description+" 反复写入和淘汰后时间轮的条目数",static_cast<std::size_t>(CAPACITY),cache.getPendingTimers());
+        for (int i=0;i<100*CAPACITY;i++)
+        {
+            cache.put(i%CAPACITY,i,1h);
+        }
+        printCheck(description+" 反复覆盖后时间轮的条目数",static_cast<std::size_t>(CAPACITY),cache.getPendingTimers());
+    }
+
+    void TestTTL()
+    {
+        std::cout<<"\nTTL测试:"<<std::endl;
+        LRU::LRUAlgorithm<int,int> lru(10);
+        LFU::LFUAlgorithm<int,int> lfu(INT_MAX,10);
+        checkTTL("LRU",lru);
+        checkTTL("LFU",lfu);
+    }
+
+    /*
+    getOrLoad测试：未命中时调用loader并写回缓存，一次加载在统计里只算一次未命中
+    多个线程同时未命中同一个key时loader只执行一次；loader抛出的异常传给调用者，结果不写入缓存
+    */
+    void TestGetOrLoad()
+    {
+        using namespace std::chrono_literals;
+        std::cout<<"\ngetOrLoad测试:"<<std::endl;
+        LRU::LRUAlgorithm<int,int> lru(10);
+        LRU::ShardedLRU<int,int,4> sharded(10);
+        std::vector<std::pair<std::string,AlgorithmStandard::Algorithmstandard<int,int>*>> caches{{"LRU",&lru},{"ShardedLRU",&sharded}};
+        for (auto& [description,cache] : caches)
+        {
+            int loads=0;
+            const auto loader=[&loads](const int& key)
+            {
+                loads++;
+                return key*10;
+            };
+            printCheck(description+" 未命中时返回加载的value",10,cache->getOrLoad(1,loader));
+            printCheck(description+" 命中时返回缓存的value",10,cache->getOrLoad(1,loader));
+            printCheck(description+" loader调用次数",1,loads);
+            const AlgorithmStandard::CacheStats stats=cache->stats();
+            printCheck(description+" 统计的未命中次数",std::uint64_t{1},stats.misses);
+            printCheck(description+" 统计的命中次数",std::uint64_t{1},stats.hits);
+
+            std::atomic<int> concurrentLoads{0};
+            constexpr int THREADS=8;
+            std::vector<int> results(THREADS);
+            std::vector<std::thread> threads;
+            for (int i=0;i<THREADS;i++)
+            {
+                threads.emplace_back([&,i]
+                {
+                    results[i]=cache->getOrLoad(2,[&concurrentLoads](const int& key)
+                    {
+                        concurrentLoads++;
+                        std::this_thread::sleep_for(100ms);
+                        return key*10;
+                    });
+                });
+            }
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+            printCheck(description+" 并发未命中时loader调用次数",1,concurrentLoads.load());
+            printCheck(description+" 所有线程拿到的value都正确",true,std::ranges::all_of(results,[](const int v){return v==20;}));
+
+            bool thrown=false;
+            try
+            {
+                cache->getOrLoad(3,[](const int&)->int
+                {
+                    throw std::runtime_error("load failed");
+                });
+            }
+            catch (const std::runtime_error&)
+            {
+                thrown=true;
+            }
+            int value=0;
+            printCheck(description+" loader抛出的异常传给调用者",true,thrown);
+            printCheck(description+" 失败的结果不写入缓存",false,cache->get(3,value));
+            printCheck(description+" 失败后重新加载",30,cache->getOrLoad(3,loader));
+        }
+    }
+
+    // 测试用的最简单的协程类型：创建后立即执行，结束时不挂起，结果由协程体自己写到外面
+    struct DetachedTask
+    {
+        struct promise_type
+        {
+            DetachedTask get_return_object()
+            {
+                return {};
+            }
+            std::suspend_never initial_suspend() noexcept
+            {
+                return {};
+            }
+            std::suspend_never final_suspend() noexcept
+            {
+                return {};
+            }
+            void return_void(){}
+            void unhandled_exception()
+            {
+                std::terminate();
+            }
+        };
+    };
+
+    // co_await一次getAsync，value或异常信息写到result/error里；调用者保证这几个引用在协程结束前有效
+    template<typename Cache,typename Loader>
+    DetachedTask awaitAsync(Cache& cache,const int key,Loader loader,std::optional<int>& result,std::string& error)
+    {
+        try
+        {
+            result=co_await cache.getAsync(key,loader);
+        }
+        catch (const std::exception& e)
+        {
+            error=e.what();
+        }
+    }
+
+    /*
+    getAsync测试：loader同步完成时不挂起；异步完成时同一个key的多个协程只调用一次loader，done之后一起恢复
+    done.fail、loader同步抛出、done的所有拷贝都没调用就被丢弃，这三种情况等待者都要收到异常，结果不写入缓存
+    */
+    void TestGetAsync()
+    {
+        std::cout<<"\ngetAsync测试:"<<std::endl;
+        LRU::LRUAlgorithm<int,int> lru(10);
+        std::optional<int> result;
+        std::string error;
+        int value=0;
+
+        awaitAsync(lru,1,[](const int& key,auto done){done(key*10);},result,error);
+        printCheck("同步完成的loader返回value",10,result.value_or(-1));
+        printCheck("加载后写回缓存",true,lru.get(1,value) && value==10);
+        printCheck("统计的未命中次数",std::uint64_t{1},lru.stats().misses);
+
+        std::vector<std::function<void(int)>> pending;
+        int loads=0;
+        const auto deferred=[&](const int&,auto done)
+        {
+            loads++;
+            pending.push_back(done);
+        };
+        std::optional<int> first;
+        std::optional<int> second;
+        std::string firstError;
+        std::string secondError;
+        awaitAsync(lru,2,deferred,first,firstError);
+        awaitAsync(lru,2,deferred,second,secondError);
+        printCheck("done之前两个协程都挂起",false,first.has_value() || second.has_value());
+        printCheck("同一个key只调用一次loader",1,loads);
+        pending.front()(20);
+        pending.clear();
+        printCheck("done之后两个协程都拿到value",true,first==20 && second==20);
+
+        std::vector<std::function<void(std::exception_ptr)>> failers;
+        result.reset();
+        awaitAsync(lru,3,[&](const int&,auto done)
+        {
+            failers.push_back([done](std::exception_ptr e){done.fail(std::move(e));});
+        },result,error);
+        failers.front()(std::make_exception_ptr(std::runtime_error("backend down")));
+        failers.clear();
+        printCheck("done.fail的异常传给等待者",std::string("backend down"),error);
+        printCheck("失败的结果不写入缓存",false,lru.get(3,value));
+
+        // 迟到的done：Flight已经失败或者已经完成，value不能写进缓存
+        std::vector<std::function<void(int)>> late;
+        awaitAsync(lru,6,[&](const int&,auto done)
+        {
+            late.push_back(done);
+            done.fail(std::make_exception_ptr(std::runtime_error("timeout")));
+        },result,error);
+        late.front()(60);
+        printCheck("失败之后迟到的done不写入缓存",false,lru.get(6,value));
+        late.clear();
+        result.reset();
+        awaitAsync(lru,7,[&](const int&,auto done){late.push_back(done);},result,error);
+        late.front()(70);
+        lru.put(71,7);
+        late.front()(72);
+        late.clear();
+        printCheck("完成之后重复调用done不覆盖之后的put",true,lru.get(7,value) && value==71);
+        printCheck("等待者拿到第一次完成的value",70,result.value_or(-1));
+
+        error.clear();
+        awaitAsync(lru,4,[](const int&,auto)->void{throw std::runtime_error("loader threw");},result,error);
+        printCheck("loader同步抛出的异常传给等待者",std::string("loader threw"),error);
+
+        error.clear();
+        std::vector<std::function<void(int)>> dropped;
+        awaitAsync(lru,5,[&](const int&,auto done){dropped.push_back(done);},result,error);
+        printCheck("done还有拷贝时协程继续等待",true,error.empty());
+        dropped.clear();
+        printCheck("done的拷贝全部丢弃后等待者收到异常",false,error.empty());
+        printCheck("丢弃后不写入缓存",false,lru.get(5,value));
     }
 
     void printResult(const int operations,const int hits, const std::string& description)
@@ -166,5 +904,21 @@ namespace TEST
 int main()
 {
     TEST::TestAlgorithm();
+    TEST::TestAgingLatency();
+    TEST::TestScanResistance();
+    TEST::TestCapacity();
+    TEST::TestHandle();
+    TEST::TestInsert();
+    TEST::TestFlatIndex();
+    TEST::TestBatch();
+    TEST::TestTTL();
+    TEST::TestWeigher();
+    TEST::TestGetOrLoad();
+    TEST::TestGetAsync();
+    if (TEST::FailedChecks!=0)
+    {
+        std::cout<<"有 "<<TEST::FailedChecks<<" 项检查不通过"<<std::endl;
+        return 1;
+    }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace TTL
+{
+    // schedule返回的句柄，缓存把它存在节点上，覆盖或删除节点时用它取消
+    using TimerHandle=std::uint32_t;
+    inline constexpr TimerHandle NO_TIMER=UINT32_MAX;
+
+    /*
+    分层时间轮：给带TTL的条目安排过期时刻，由缓存在每次操作时顺带推进
+    时间以tick为单位（1ms），tick 0保留给“不过期”，所以第一个有效tick是1
+    LEVELS层，每层SLOTS个槽：第0层一个槽是1个tick，第1层一个槽是64个tick，依此类推，四层覆盖约4.6小时
+    更远的过期时刻先放在最高层最远的槽里，到时候级联下来会重新计算位置，不会提前过期
+    推进到某一层的槽边界时，把上一层对应槽里的条目按剩余时间重新放到更低的层（级联），第0层的槽到点就触发
+    条目放在一段连续的vector里，每个槽是用下标串起来的双向链表：
+    key被覆盖、被删除时缓存用句柄把条目从槽里摘掉（O(1)），摘下的条目进空闲链表复用，条目数不会超过带TTL的节点数
+    */
+    template<typename Key>
+    class TimerWheel
+    {
+        static constexpr int LEVELS=4;
+        static constexpr int BITS=6;
+        static constexpr std::uint64_t SLOTS=1ULL<<BITS;
+        static constexpr std::uint64_t SLOT_MASK=SLOTS-1;
+        // 一次推进最多走这么多步，长时间空闲后补课的工作量分摊到后续的多次操作上
+        static constexpr int MAX_STEPS_PER_ADVANCE=256;
+        static constexpr std::uint32_t NIL=UINT32_MAX;
+
+        struct Entry
+        {
+            Key key;
+            std::uint64_t deadline;
+            std::uint32_t prev;
+            std::uint32_t next; // 在空闲链表里时指向下一个空闲条目
+            std::uint32_t slot; // 所在的槽（层号*SLOTS+槽号），NIL表示不在任何槽里
+        };
+
+        std::vector<Entry> entries;
+        std::array<std::uint32_t,LEVELS*SLOTS> heads;
+        std::array<std::size_t,LEVELS> levelCount;
+        std::uint32_t freeHead;
+        std::uint64_t currentTick;
+        std::size_t entryCount;
+        std::chrono::steady_clock::time_point origin;
+
+        static int levelOf(const std::uint32_t slot)
+        {
+            return static_cast<int>(slot/SLOTS);
+        }
+
+        void link(const std::uint32_t index,const std::uint32_t slot)
+        {
+            Entry& entry=entries[index];
+            entry.slot=slot;
+            entry.prev=NIL;
+            entry.next=heads[slot];
+            if (heads[slot]!=NIL) entries[heads[slot]].prev=index;
+            heads[slot]=index;
+            levelCount[levelOf(slot)]++;
+        }
+
+        void unlink(const std::uint32_t index)
+        {
+            Entry& entry=entries[index];
+            if (entry.prev!=NIL) entries[entry.prev].next=entry.next;
+            else heads[entry.slot]=entry.next;
+            if (entry.next!=NIL) entries[entry.next].prev=entry.prev;
+            levelCount[levelOf(entry.slot)]--;
+            entry.slot=NIL;
+        }
+
+        // 调用前条目必须已经不在任何槽里
+        void release(const std::uint32_t index)
+        {
+            entries[index].next=freeHead;
+            freeHead=index;
+            entryCount--;
+        }
+
+        void place(const std::uint32_t index)
+        {
+            // 已经过期的条目放到下一个tick触发
+            const std::uint64_t tick=std::max(entries[index].deadline,currentTick+1);
+            const std::uint64_t delta=tick-currentTick;
+            for (int level=0;level<LEVELS;level++)
+            {
+                if (delta<(1ULL<<(BITS*(level+1))))
+                {
+                    link(index,static_cast<std::uint32_t>(level*SLOTS+((tick>>(BITS*level))&SLOT_MASK)));
+                    return;
+                }
+            }
+            constexpr int TOP=LEVELS-1;
+            link(index,static_cast<std::uint32_t>(TOP*SLOTS+(((currentTick>>(BITS*TOP))+SLOT_MASK)&SLOT_MASK)));
+        }
+
+        // 整个槽先摘下来再逐个处理，重新放置的条目不会在这一轮里被再次访问
+        template<typename F>
+        void cascade(const int level,const std::uint64_t slot,F& onExpire)
+        {
+            const auto id=static_cast<std::uint32_t>(level*SLOTS+slot);
+            std::uint32_t index=heads[id];
+            heads[id]=NIL;
+            while (index!=NIL)
+            {
+                const std::uint32_t next=entries[index].next;
+                levelCount[level]--;
+                entries[index].slot=NIL;
+                if (entries[index].deadline<=currentTick)
+                {
+                    // 先回收再回调：回调删除节点时句柄已经失效，不会再来取消它
+                    release(index);
+                    onExpire(entries[index].key,index);
+                }
+                else
+                {
+                    place(index);
+                }
+                index=next;
+            }
+        }
+
+    public:
+        TimerWheel():levelCount{},freeHead(NIL),currentTick(0),entryCount(0),origin(std::chrono::steady_clock::now())
+        {
+            heads.fill(NIL);
+        }
+
+        bool empty() const
+        {
+            return entryCount==0;
+        }
+
+        // 还没有触发、也没有取消的条目数
+        std::size_t size() const
+        {
+            return entryCount;
+        }
+
+        std::uint64_t now() const
+        {
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now()-origin).count())+1;
+        }
+
+        // ttl不足1ms按1ms算，非正数表示立即过期
+        std::uint64_t deadlineAfter(const std::chrono::milliseconds ttl) const
+        {
+            return now()+static_cast<std::uint64_t>(std::max<std::chrono::milliseconds::rep>(ttl.count(),0));
+        }
+
+        TimerHandle schedule(const Key& key,const std::uint64_t deadline)
+        {
+            if (entryCount==0)
+            {
+                // 时间轮空着的时候缓存不会推进它，先追上当前时刻，否则下一次推进要从很久以前的tick一路级联过来
+                currentTick=std::max(currentTick,now());
+            }
+            std::uint32_t index;
+            if (freeHead!=NIL)
+            {
+                index=freeHead;
+                freeHead=entries[index].next;
+                entries[index].key=key;
+                entries[index].deadline=deadline;
+            }
+            else
+            {
+                index=static_cast<std::uint32_t>(entries.size());
+                entries.push_back(Entry{key,deadline,NIL,NIL,NIL});
+            }
+            entryCount++;
+            place(index);
+            return index;
+        }
+
+        // 句柄必须是还没有触发、也没有取消过的
+        void cancel(const TimerHandle handle)
+        {
+            unlink(handle);
+            release(handle);
+        }
+
+        /*
+        推进到tick now，对每个到期的条目调用 onExpire(key,handle)，调用时句柄已经回收
+        回调里只能删除这个条目对应的节点，不能再schedule、cancel其他句柄
+        低层全空时直接跳到下一个需要级联的边界，空闲再久也只走很少几步
+        */
+        template<typename F>
+        void advance(const std::uint64_t now,F&& onExpire)
+        {
+            if (entryCount==0)
+            {
+                currentTick=std::max(currentTick,now);
+                return;
+            }
+            for (int step=0;step<MAX_STEPS_PER_ADVANCE && currentTick<now;step++)
+            {
+                std::uint64_t next=currentTick+1;
+                for (int level=0;level<LEVELS-1 && levelCount[level]==0;level++)
+                {
+                    const int shift=BITS*(level+1);
+                    next=((currentTick>>shift)+1)<<shift;
+                }
+                currentTick=std::min(next,now);
+                // 先级联高层再处理低层，高层落下来的条目可能正好落在这一刻要处理的低层槽里
+                for (int level=LEVELS-1;level>0;level--)
+                {
+                    const int shift=BITS*level;
+                    if ((currentTick&((1ULL<<shift)-1))==0)
+                    {
+                        cascade(level,(currentTick>>shift)&SLOT_MASK,onExpire);
+                    }
+                }
+                cascade(0,currentTick&SLOT_MASK,onExpire);
+                if (entryCount==0)
+                {
+                    currentTick=now;
+                    return;
+                }
+            }
+        }
+    };
+}
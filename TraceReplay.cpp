@@ -0,0 +1,405 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <charconv>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <optional>
+#include <unordered_set>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "AlgorithmStandard.h"
+#include "CacheEngines.h"
+
+/*
+访问日志回放：把真实的访问序列按原顺序交给每个算法，比较命中率和吞吐
+trace文件通过mmap映射，边读边解码，不会整个读进内存，可以回放比内存还大的日志
+读请求未命中时像真实业务一样把对象写回缓存；写请求直接put，不计入命中率
+用法: CacheTraceReplay <trace文件> [--format text|oracle] [--capacity 1000,10000] [--engines LRU,ARC] [--limit 请求数]
+*/
+namespace REPLAY
+{
+    // key是对象编号，value存对象大小，用来统计字节命中率
+    using Cache=AlgorithmStandard::Algorithmstandard<std::uint64_t,std::uint32_t>;
+
+    struct Request
+    {
+        std::uint64_t key;
+        std::uint32_t size;
+        bool isWrite;
+    };
+
+    enum class TraceFormat
+    {
+        TEXT,
+        ORACLE
+    };
+
+    struct ReplayConfig
+    {
+        std::string path;
+        TraceFormat format=TraceFormat::TEXT;
+        bool formatGiven=false;
+        std::vector<std::size_t> capacities; // 为空时按trace里不同key个数的1%和10%
+        std::vector<std::string> engines;    // 为空时回放所有算法
+        std::uint64_t limit=0;               // 0表示不限制
+    };
+
+    struct ReplayResult
+    {
+        std::uint64_t gets=0;
+        std::uint64_t hits=0;
+        std::uint64_t bytes=0;
+        std::uint64_t hitBytes=0;
+        std::uint64_t requests=0;
+        double seconds=0;
+    };
+
+    // 只读映射整个文件，析构时解除映射；空文件或打开失败时data()为空
+    class MappedFile
+    {
+        const char* begin=nullptr;
+        std::size_t length=0;
+
+    public:
+        explicit MappedFile(const std::string& path)
+        {
+            const int fd=::open(path.c_str(),O_RDONLY);
+            if (fd<0)
+            {
+                return;
+            }
+            struct stat info{};
+            if (::fstat(fd,&info)==0 && info.st_size>0)
+            {
+                void* mapped=::mmap(nullptr,static_cast<std::size_t>(info.st_size),PROT_READ,MAP_PRIVATE,fd,0);
+                if (mapped!=MAP_FAILED)
+                {
+                    begin=static_cast<const char*>(mapped);
+                    length=static_cast<std::size_t>(info.st_size);
+                    ::madvise(mapped,length,MADV_SEQUENTIAL);
+                    // 只顺序读一遍，让内核提前预读、读过的页尽早回收
+                }
+            }
+            ::close(fd);
+            // 映射建立后文件描述符就不再需要了
+        }
+        ~MappedFile()
+        {
+            if (begin!=nullptr)
+            {
+                ::munmap(const_cast<char*>(begin),length);
+            }
+        }
+        MappedFile(const MappedFile&)=delete;
+        MappedFile& operator=(const MappedFile&)=delete;
+
+        const char* data() const
+        {
+            return begin;
+        }
+        std::size_t size() const
+        {
+            return length;
+        }
+    };
+
+    /*
+    文本格式：每行一个请求 key[,op[,size]]，字段之间用逗号、空格或制表符分隔，空行和#开头的行跳过
+    key是十进制整数；不是整数时按字符串哈希成整数，URL之类的key也能直接用
+    op以g/r开头（get、read）是读，以s/p/w/u开头（set、put、write、update）是写，省略或无法识别时按读处理
+    size省略时按1计算
+    */
+    class TextTraceReader
+    {
+        const char* position;
+        const char* end;
+
+        static bool isSeparator(const char c)
+        {
+            return c==',' || c==' ' || c=='\t' || c=='\r';
+        }
+
+        // 把一行拆成最多3个字段，返回字段个数
+        static std::size_t splitFields(std::string_view line,std::string_view (&fields)[3])
+        {
+            std::size_t count=0;
+            std::size_t i=0;
+            while (i<line.size() && count<3)
+            {
+                while (i<line.size() && isSeparator(line[i])) i++;
+                const std::size_t start=i;
+                while (i<line.size() && !isSeparator(line[i])) i++;
+                if (i>start) fields[count++]=line.substr(start,i-start);
+            }
+            return count;
+        }
+
+        static std::uint64_t parseKey(const std::string_view field)
+        {
+            std::uint64_t key=0;
+            const auto [rest,error]=std::from_chars(field.data(),field.data()+field.size(),key);
+            if (error==std::errc() && rest==field.data()+field.size())
+            {
+                return key;
+            }
+            return std::hash<std::string_view>{}(field);
+        }
+
+        static bool isWriteOperation(const std::string_view field)
+        {
+            switch (field[0])
+            {
+                case 's': case 'S': case 'p': case 'P': case 'w': case 'W': case 'u': case 'U':
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        static std::uint32_t parseSize(const std::string_view field)
+        {
+            std::uint32_t size=1;
+            std::from_chars(field.data(),field.data()+field.size(),size);
+            return size;
+        }
+
+    public:
+        TextTraceReader(const char* data,const std::size_t size):position(data),end(data+size){}
+
+        bool next(Request& request)
+        {
+            while (position<end)
+            {
+                const auto* lineEnd=static_cast<const char*>(std::memchr(position,'\n',static_cast<std::size_t>(end-position)));
+                if (lineEnd==nullptr) lineEnd=end;
+                const std::string_view line(position,static_cast<std::size_t>(lineEnd-position));
+                position=lineEnd==end?end:lineEnd+1;
+
+                std::string_view fields[3];
+                const std::size_t count=splitFields(line,fields);
+                if (count==0 || fields[0][0]=='#')
+                {
+                    continue;
+                }
+                request.key=parseKey(fields[0]);
+                request.isWrite=count>1 && isWriteOperation(fields[1]);
+                request.size=count>2?parseSize(fields[2]):1;
+                return true;
+            }
+            return false;
+        }
+    };
+
+    /*
+    oracleGeneral二进制格式（libCacheSim等公开trace常用）：每条记录24字节，小端，没有文件头
+    uint32 时间戳, uint64 对象编号, uint32 对象大小, int64 下一次访问的位置
+    这个格式里没有读写之分，全部按读请求处理；时间戳和下一次访问位置不使用
+    */
+    class OracleTraceReader
+    {
+        static constexpr std::size_t RECORD_SIZE=24;
+
+        const char* position;
+        const char* end;
+
+    public:
+        // 末尾不足一条记录的残余字节直接忽略
+        OracleTraceReader(const char* data,const std::size_t size):
+            position(data),end(data+size/RECORD_SIZE*RECORD_SIZE){}
+
+        bool next(Request& request)
+        {
+            if (position==end)
+            {
+                return false;
+            }
+            // 记录没有按8字节对齐，用memcpy读取，编译后就是普通的load
+            std::memcpy(&request.key,position+4,sizeof(request.key));
+            std::memcpy(&request.size,position+12,sizeof(request.size));
+            request.isWrite=false;
+            position+=RECORD_SIZE;
+            return true;
+        }
+    };
+
+    /*
+    按trace顺序驱动一个缓存；cache为空时只解码不访问缓存，用来测出解码本身的耗时
+    limit为0表示回放整个文件
+    */
+    template<typename Reader>
+    ReplayResult replay(Cache* cache,Reader reader,const std::uint64_t limit)
+    {
+        ReplayResult result;
+        Request request{};
+        std::uint32_t size=0;
+        const auto begin=std::chrono::steady_clock::now();
+        while ((limit==0 || result.requests<limit) && reader.next(request))
+        {
+            result.requests++;
+            if (cache==nullptr)
+            {
+                result.bytes+=request.size;
+                continue;
+            }
+            if (request.isWrite)
+            {
+                cache->put(request.size,request.key);
+                continue;
+            }
+            result.gets++;
+            result.bytes+=request.size;
+            if (cache->get(request.key,size))
+            {
+                result.hits++;
+                result.hitBytes+=request.size;
+            }
+            else
+            {
+                cache->put(request.size,request.key);
+            }
+        }
+        result.seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count();
+        return result;
+    }
+
+    template<typename Reader>
+    std::size_t countDistinctKeys(Reader reader,const std::uint64_t limit)
+    {
+        std::unordered_set<std::uint64_t> keys;
+        Request request{};
+        std::uint64_t requests=0;
+        while ((limit==0 || requests<limit) && reader.next(request))
+        {
+            requests++;
+            keys.insert(request.key);
+        }
+        return keys.size();
+    }
+
+    // 把 "1000,10000" 这样的参数拆成列表
+    void printUsage()
+    {
+        std::cout<<"用法: CacheTraceReplay <trace文件> [--format text|oracle] [--capacity 1000,10000] [--engines LRU,ARC] [--limit 请求数]"<<std::endl;
+    }
+
+    // 参数里的数字不合法时打印出错的参数并返回空，由main打印用法
+    std::optional<ReplayConfig> parseArguments(const int argc,char* argv[])
+    {
+        ReplayConfig config;
+        if (argc>1) config.path=argv[1];
+        for (int i=2;i+1<argc;i+=2)
+        {
+            const std::string option=argv[i];
+            const std::string argument=argv[i+1];
+            if (option=="--format")
+            {
+                config.format=argument=="oracle"?TraceFormat::ORACLE:TraceFormat::TEXT;
+                config.formatGiven=true;
+            }
+            else if (option=="--capacity")
+            {
+                for (const auto& item : ENGINES::splitList(argument))
+                {
+                    std::uint64_t capacity=0;
+                    if (!ENGINES::parseCount(item,capacity))
+                    {
+                        std::cout<<"无效的容量: "<<item<<std::endl;
+                        return std::nullopt;
+                    }
+                    config.capacities.push_back(std::max<std::size_t>(1,capacity));
+                }
+            }
+            else if (option=="--engines") config.engines=ENGINES::splitList(argument);
+            else if (option=="--limit")
+            {
+                if (!ENGINES::parseCount(argument,config.limit))
+                {
+                    std::cout<<"无效的请求数: "<<argument<<std::endl;
+                    return std::nullopt;
+                }
+            }
+            else std::cout<<"忽略未知参数: "<<option<<std::endl;
+        }
+        if (!config.formatGiven && config.path.find("oracleGeneral")!=std::string::npos)
+        {
+            config.format=TraceFormat::ORACLE;
+            // 公开trace的文件名里通常带着格式名
+        }
+        return config;
+    }
+
+    void printResult(const std::string& name,const std::size_t capacity,const ReplayResult& result)
+    {
+        const double hitRate=result.gets==0?0.0:static_cast<double>(result.hits)/static_cast<double>(result.gets);
+        const double byteHitRate=result.bytes==0?0.0:static_cast<double>(result.hitBytes)/static_cast<double>(result.bytes);
+        const double opsPerSecond=result.seconds>0?static_cast<double>(result.requests)/result.seconds:0.0;
+        std::cout<<std::left<<std::setw(16)<<name<<std::right
+                 <<std::setw(12)<<capacity
+                 <<std::setw(14)<<result.requests
+                 <<std::setw(10)<<std::fixed<<std::setprecision(4)<<hitRate
+                 <<std::setw(12)<<byteHitRate
+                 <<std::setw(14)<<std::setprecision(0)<<opsPerSecond<<std::endl;
+    }
+
+    template<typename Reader>
+    void RunReplay(const ReplayConfig& config,const Reader& reader)
+    {
+        std::vector<std::size_t> capacities=config.capacities;
+        if (capacities.empty())
+        {
+            const std::size_t distinct=countDistinctKeys(reader,config.limit);
+            std::cout<<"不同的key: "<<distinct<<std::endl;
+            capacities={std::max<std::size_t>(distinct/100,1),std::max<std::size_t>(distinct/10,1)};
+        }
+
+        std::cout<<std::left<<std::setw(16)<<"算法"<<std::right<<std::setw(12)<<"容量"<<std::setw(14)<<"请求数"
+                 <<std::setw(10)<<"命中率"<<std::setw(12)<<"字节命中率"<<std::setw(14)<<"ops/s"<<std::endl;
+        // 吞吐包含解码trace的时间，先单独测一遍解码作为参照
+        printResult("(仅解码)",0,replay(nullptr,reader,config.limit));
+        for (const std::size_t capacity : capacities)
+        {
+            for (const auto& engine : ENGINES::makeEngines<std::uint64_t,std::uint32_t>())
+            {
+                if (!config.engines.empty() && std::find(config.engines.begin(),config.engines.end(),engine.name)==config.engines.end())
+                {
+                    continue;
+                }
+                auto cache=engine.create(capacity);
+                printResult(engine.name,capacity,replay(cache.get(),reader,config.limit));
+            }
+        }
+    }
+}
+
+int main(int argc,char* argv[])
+{
+    const std::optional<REPLAY::ReplayConfig> parsed=REPLAY::parseArguments(argc,argv);
+    if (!parsed || parsed->path.empty())
+    {
+        REPLAY::printUsage();
+        return 1;
+    }
+    const REPLAY::ReplayConfig& config=*parsed;
+    const REPLAY::MappedFile file(config.path);
+    if (file.data()==nullptr)
+    {
+        std::cout<<"无法读取trace文件（不存在或为空）: "<<config.path<<std::endl;
+        return 1;
+    }
+    if (config.format==REPLAY::TraceFormat::ORACLE)
+    {
+        REPLAY::RunReplay(config,REPLAY::OracleTraceReader(file.data(),file.size()));
+    }
+    else
+    {
+        REPLAY::RunReplay(config,REPLAY::TextTraceReader(file.data(),file.size()));
+    }
+    return 0;
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include "AlgorithmStandard.h"
+#include "FlatIndex.h"
+#include "LRUAlgorithm.h"
+
+namespace TwoQ
+{
+    /*
+    2Q（Johnson & Shasha的完整版本）
+    A1in：第一次进入缓存的数据，FIFO，命中也不调整位置，最多约占容量的1/4
+    A1out：从A1in淘汰出去的key（幽灵表，只保留key不保留value），FIFO，最多记住容量的1/2个key
+    Am：在A1out里再次遇到的key，说明它不是只访问一次的数据，放进Am按LRU管理
+    一次顺序扫描的冷key只会在A1in里进出，经过A1out后也只是幽灵，不会挤掉Am里的热点数据
+    三条链表放在同一个LRUNodePool里，链表头部是各自最早进入（或最久未访问）的节点
+    */
+    template<typename Key,typename Value>
+    class TwoQAlgorithm final : public AlgorithmStandard::Algorithmstandard<Key,Value>
+    {
+        static constexpr std::uint32_t A1IN=0;
+        static constexpr std::uint32_t A1OUT=1;
+        static constexpr std::uint32_t AM=2;
+
+        using Index=AlgorithmStandard::FlatIndex<Key,std::uint32_t>;
+
+        Index cache; // 同时索引真实数据（A1in/Am）和幽灵key（A1out），通过节点的list区分
+        LRU::LRUNodePool<Key,Value> pool;
+        std::size_t listSize[3];
+        std::size_t capacity;
+        std::size_t inCapacity;  // Kin
+        std::size_t outCapacity; // Kout
+        AlgorithmStandard::TimedMutex<std::mutex> mutex{this->statistics};
+
+        void moveTo(const std::uint32_t list,const std::uint32_t index)
+        {
+            listSize[pool[index].list]--;
+            pool.moveNodeToLast(list,index);
+            listSize[list]++;
+        }
+
+        void deleteFirst(const std::uint32_t list)
+        {
+            const std::uint32_t index=pool.first(list);
+            cache.erase(pool[index].key);
+            pool.removeNode(index);
+            pool.release(index);
+            listSize[list]--;
+        }
+
+        /*
+        缓存已满时腾出一个位置
+        A1in超过Kin时淘汰A1in最早的数据，key留在A1out里；否则淘汰Am最久未访问的数据
+        */
+        void reclaim()
+        {
+            if (listSize[A1IN]+listSize[AM]<capacity)
+            {
+                return;
+            }
+            CACHE_LATENCY_SCOPE(EVICTION);
+            if (listSize[A1IN]>inCapacity || listSize[AM]==0)
+            {
+                const std::uint32_t index=pool.first(A1IN);
+                pool[index].value=Value{};
+                // 幽灵节点不再需要value，及时释放它占用的内存
+                moveTo(A1OUT,index);
+                if (listSize[A1OUT]>outCapacity)
+                {
+                    deleteFirst(A1OUT);
+                }
+            }
+            else
+            {
+                deleteFirst(AM);
+            }
+            this->statistics.record(AlgorithmStandard::StatsEvent::EVICTION);
+        }
+
+        template<typename V>
+        void putValue(V&& val,const Key& key)
+        {
+            CACHE_LATENCY_SCOPE(PUT);
+            std::lock_guard lock(mutex);
+            if (capacity==0)
+            {
+                return;
+            }
+            auto [iter,inserted]=cache.try_emplace(key,LRU::NIL_INDEX);
+            this->recordPut(!inserted && pool[iter->second].list!=A1OUT);
+            if (!inserted)
+            {
+                const std::uint32_t index=iter->second;
+                const std::uint32_t list=pool[index].list;
+                if (list==A1OUT)
+                {
+                    // 幽灵命中：第二次访问，带着value进入Am
+                    // value先写进去，赋值抛出异常时它仍然是A1out里完整的幽灵
+                    // 再从A1out摘下，reclaim往A1out里放新幽灵时不会把它当作最旧的幽灵删掉
+                    pool[index].value=std::forward<V>(val);
+                    pool.removeNode(index);
+                    listSize[A1OUT]--;
+                    reclaim();
+                    pool.addNodeToLast(AM,index);
+                    listSize[AM]++;
+                    return;
+                }
+                pool[index].value=std::forward<V>(val);
+                if (list==AM)
+                {
+                    pool.moveNodeToLast(AM,index);
+                }
+                return;
+            }
+            // key、value先拷贝好再腾位置：拷贝抛出异常时缓存没有任何变化，只需要由guard撤销占位
+            AlgorithmStandard::PlaceholderGuard placeholder(cache,iter);
+            Key NewKey=key;
+            Value NewValue(std::forward<V>(val));
+            reclaim();
+            // reclaim可能删除A1out里的key，FlatIndex的erase不会移动其他元素，iter仍然有效
+            const std::uint32_t NewIndex=pool.allocate(std::move(NewKey),std::move(NewValue));
+            iter->second=NewIndex;
+            pool.addNodeToLast(A1IN,NewIndex);
+            listSize[A1IN]++;
+            placeholder.release();
+        }
+
+    public:
+        /*
+        Kin取容量的1/4，Kout取容量的1/2，是原论文推荐的比例
+        容量很小时Kin可能为0，这时新数据总是先从A1in淘汰，A1out至少记住1个key
+        */
+        explicit TwoQAlgorithm(const std::size_t capacity=DEFAULT_CACHE_CAPACITY):
+            pool(capacity+std::max<std::size_t>(capacity/2,1)+1,3),listSize{0,0,0},
+            capacity(capacity),inCapacity(capacity/4),outCapacity(std::max<std::size_t>(capacity/2,1))
+        {
+            cache.reserve(capacity+outCapacity+1);
+        }
+        ~TwoQAlgorithm() override=default;
+
+        bool get(const Key& key, Value& value) override
+        {
+            CACHE_LATENCY_SCOPE(GET);
+            std::lock_guard lock(mutex);
+            auto iter=cache.find(key);
+            if (iter==cache.end())
+            {
+                return this->recordLookup(false);
+            }
+            const std::uint32_t index=iter->second;
+            const std::uint32_t list=pool[index].list;
+            if (list==A1OUT)
+            {
+                // 幽灵表里只有key，对get来说仍是未命中，等put带着value回来时再进入Am
+                return this->recordLookup(false);
+            }
+            value=pool[index].value;
+            if (list==AM)
+            {
+                pool.moveNodeToLast(AM,index);
+            }
+            // A1in里的命中不调整位置，短时间内的重复访问不能证明它是热点数据
+            return this->recordLookup(true);
+        }
+
+        void put(const Value& val,const Key& key) override
+        {
+            putValue(val,key);
+        }
+
+        void put(Value&& val,const Key& key) override
+        {
+            putValue(std::move(val),key);
+        }
+
+        std::size_t getCapacity()
+        {
+            std::lock_guard lock(mutex);
+            return capacity;
+        }
+    };
+}
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <mutex>
+#include "LRUAlgorithm.h"
+#include "AlgorithmStandard.h"
+
+namespace TinyLFU
+{
+    /*
+    Count-Min Sketch 频率估计器
+    DEPTH行计数器，每个key在每一行按不同的哈希落到一个4位计数器上，估计值取各行的最小值
+    16个4位计数器压在一个uint64里，宽度只和容量有关，不随访问过的key数量增长
+    累计记录次数达到 sampleSize 后所有计数器减半，让过去的热点逐渐降温（相当于LFU的老化）
+    */
+    template<typename Key>
+    class CountMinSketch
+    {
+        static constexpr int DEPTH=4;
+        static constexpr std::uint64_t MAX_COUNT=15;
+        static constexpr std::uint64_t SEEDS[DEPTH]={0x9E3779B97F4A7C15ULL,0xC2B2AE3D27D4EB4FULL,0x165667B19E3779F9ULL,0x27D4EB2F165667C5ULL};
+
+        std::vector<std::uint64_t> table;
+        std::size_t width; // 每行计数器个数，2的幂
+        std::size_t sampleSize;
+        std::size_t additions;
+
+        static std::uint64_t mix(std::uint64_t x)
+        {
+            // splitmix64的收尾步骤，把std::hash的结果充分打散
+            x^=x>>30;
+            x*=0xBF58476D1CE4E5B9ULL;
+            x^=x>>27;
+            x*=0x94D049BB133111EBULL;
+            x^=x>>31;
+            return x;
+        }
+        std::size_t counterIndex(const std::uint64_t hash,const int row) const
+        {
+            return static_cast<std::size_t>(row)*width+(mix(hash^SEEDS[row])&(width-1));
+        }
+        std::uint64_t counterAt(const std::size_t index) const
+        {
+            return (table[index/16]>>((index%16)*4))&0xF;
+        }
+
+    public:
+        explicit CountMinSketch(const std::size_t capacity)
+        {
+            width=16;
+            while (width<capacity) width<<=1;
+            table.assign(DEPTH*width/16,0);
+            sampleSize=10*std::max<std::size_t>(capacity,1);
+            additions=0;
+        }
+
+        void increment(const Key& key)
+        {
+            const std::uint64_t hash=std::hash<Key>{}(key);
+            bool added=false;
+            for (int row=0;row<DEPTH;row++)
+            {
+                const std::size_t index=counterIndex(hash,row);
+                if (counterAt(index)<MAX_COUNT)
+                {
+                    table[index/16]+=1ULL<<((index%16)*4);
+                    added=true;
+                }
+            }
+            if (added && ++additions>=sampleSize)
+            {
+                halve();
+            }
+        }
+
+        int estimate(const Key& key) const
+        {
+            const std::uint64_t hash=std::hash<Key>{}(key);
+            std::uint64_t frequency=MAX_COUNT;
+            for (int row=0;row<DEPTH;row++)
+            {
+                frequency=std::min(frequency,counterAt(counterIndex(hash,row)));
+            }
+            return static_cast<int>(frequency);
+        }
+
+        // 每个4位计数器右移一位，掩码去掉从高位计数器移过来的那一位
+        void halve()
+        {
+            for (auto& word : table)
+            {
+                word=(word>>1)&0x7777777777777777ULL;
+            }
+            additions/=2;
+        }
+    };
+
+    /*
+    W-TinyLFU
+    窗口LRU（约1%容量）：新key先进窗口，给突发的新数据一个积累频率的机会
+    主缓存是分段LRU：试用段（probation）+ 保护段（protected，约占主缓存80%）
+        试用段里的节点再次被访问就升入保护段，保护段满了就把最久未访问的降回试用段
+    准入：窗口满了以后，窗口淘汰出的候选者要和试用段头部的淘汰者比较sketch估计频率，
+         候选者更高才能进入主缓存，否则直接丢弃，一次性访问的key（one-hit-wonder）挤不掉热点数据
+    */
+    template<typename Key,typename Value>
+    class WTinyLFUAlgorithm final : public AlgorithmStandard::Algorithmstandard<Key,Value>
+    {
+        static constexpr std::uint32_t WINDOW=0;
+        static constexpr std::uint32_t PROBATION=1;
+        static constexpr std::uint32_t PROTECTED=2;
+
+        std::unordered_map<Key,std::uint32_t> cache;
+        LRU::LRUNodePool<Key,Value> pool;
+        CountMinSketch<Key> sketch;
+        std::size_t capacity;
+        std::size_t windowCapacity;
+        std::size_t protectedCapacity;
+        std::size_t windowSize;
+        std::size_t probationSize;
+        std::size_t protectedSize;
+        AlgorithmStandard::TimedMutex<std::mutex> mutex{this->statistics};
+
+        void evictNode(const std::uint32_t index)
+        {
+            if (pool[index].list==PROBATION) probationSize--;
+            else if (pool[index].list==PROTECTED) protectedSize--;
+            else windowSize--;
+            cache.erase(pool[index].key);
+            pool.removeNode(index);
+            pool.release(index);
+            this->statistics.record(AlgorithmStandard::StatsEvent::EVICTION);
+        }
+
+        void onHit(const std::uint32_t index)
+        {
+            const std::uint32_t list=pool[index].list;
+            if (list==PROBATION)
+            {
+                pool.moveNodeToLast(PROTECTED,index);
+                probationSize--;
+                protectedSize++;
+                if (protectedSize>protectedCapacity)
+                {
+                    // 保护段溢出，最久未访问的降级回试用段尾部
+                    pool.moveNodeToLast(PROBATION,pool.first(PROTECTED));
+                    protectedSize--;
+                    probationSize++;
+                }
+            }
+            else
+            {
+                pool.moveNodeToLast(list,index);
+            }
+        }
+
+        // 窗口超出容量时，窗口头部的候选者尝试进入主缓存
+        void admitFromWindow()
+        {
+            while (windowSize>windowCapacity)
+            {
+                const std::uint32_t candidate=pool.first(WINDOW);
+                pool.removeNode(candidate);
+                windowSize--;
+                if (probationSize+protectedSize<capacity-windowCapacity)
+                {
+                    pool.addNodeToLast(PROBATION,candidate);
+                    probationSize++;
+                    continue;
+                }
+                CACHE_LATENCY_SCOPE(EVICTION);
+                // 主缓存已满：从这里到本轮循环结束是一次淘汰（候选者和试用段头部二选一）
+                std::uint32_t victim=pool.first(PROBATION);
+                if (pool.isEmpty(PROBATION)) victim=pool.first(PROTECTED);
+                if (victim!=PROBATION && victim!=PROTECTED &&
+                    sketch.estimate(pool[candidate].key)>sketch.estimate(pool[victim].key))
+                {
+                    evictNode(victim);
+                    pool.addNodeToLast(PROBATION,candidate);
+                    probationSize++;
+                }
+                else
+                {
+                    // 准入失败的候选者也算一次淘汰
+                    cache.erase(pool[candidate].key);
+                    pool.release(candidate);
+                    this->statistics.record(AlgorithmStandard::StatsEvent::EVICTION);
+                }
+            }
+        }
+
+    public:
+        using AlgorithmStandard::Algorithmstandard<Key,Value>::put;
+        // 右值put使用基类的默认实现（退回到拷贝版本），这里只是避免被下面的put隐藏
+
+        explicit WTinyLFUAlgorithm(const std::size_t capacity=DEFAULT_CACHE_CAPACITY):
+            pool(capacity+1,3),sketch(capacity),capacity(capacity),
+            windowSize(0),probationSize(0),protectedSize(0)
+        {
+            windowCapacity=std::max<std::size_t>(capacity/100,1);
+            if (windowCapacity>capacity) windowCapacity=capacity;
+            protectedCapacity=(capacity-windowCapacity)*8/10;
+            cache.reserve(capacity+1);
+        }
+        ~WTinyLFUAlgorithm() override=default;
+
+        bool get(const Key& key, Value& value) override
+        {
+            CACHE_LATENCY_SCOPE(GET);
+            std::lock_guard lock(mutex);
+            sketch.increment(key);
+            // 未命中也要记录频率，否则被拒绝准入的key永远攒不够频率
+            auto iter=cache.find(key);
+            if (iter==cache.end())
+            {
+                return this->recordLookup(false);
+            }
+            value=pool[iter->second].value;
+            onHit(iter->second);
+            return this->recordLookup(true);
+        }
+
+        void put(const Value& val,const Key& key) override
+        {
+            CACHE_LATENCY_SCOPE(PUT);
+            std::lock_guard lock(mutex);
+            sketch.increment(key);
+            auto [iter,inserted]=cache.try_emplace(key,0);
+            this->recordPut(!inserted);
+            if (!inserted)
+            {
+                pool[iter->second].value=val;
+                onHit(iter->second);
+                return;
+            }
+            // 先在索引里占位，插入途中抛出异常或者容量为0放弃插入时由guard撤销
+            AlgorithmStandard::PlaceholderGuard placeholder(cache,iter);
+            if (capacity==0)
+            {
+                return;
+            }
+            // key、value先拷贝好，新节点挂进窗口之后才做准入和淘汰：拷贝抛出异常时缓存没有任何变化
+            Key NewKey=key;
+            Value NewValue=val;
+            const std::uint32_t NewIndex=pool.allocate(std::move(NewKey),std::move(NewValue));
+            pool.addNodeToLast(WINDOW,NewIndex);
+            windowSize++;
+            iter->second=NewIndex;
+            placeholder.release();
+            admitFromWindow();
+        }
+
+        std::size_t getCapacity()
+        {
+            std::lock_guard lock(mutex);
+            return capacity;
+        }
+    };
+}